@@ -36,6 +36,30 @@
 	 <defaultenabled>yes</defaultenabled>
 ***/
 
+/*** DOCUMENTATION
+	<function name="OPUS_RECORD" language="en_US">
+		<synopsis>
+			Record the audio a channel sends as a track of a multitrack Ogg Opus file.
+		</synopsis>
+		<syntax>
+			<parameter name="file" required="true">
+				<para>The file to record into. Channels which name the same file share it.</para>
+			</parameter>
+			<parameter name="tracks">
+				<para>The number of tracks of the file, 1 to 255, default 8. Only the
+				first channel of a file creates it with that number.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Set it to the name of the track, for example
+			<literal>Set(OPUS_RECORD(/var/spool/asterisk/monitor/conf.opus)=${CALLERID(name)})</literal>
+			before <literal>ConfBridge()</literal>. Each channel gets the next free track; the
+			name goes into the file for the first channel only. Opus frames of 20 ms are recorded
+			without transcoding. The file is complete when the last channel hangs up.</para>
+		</description>
+	</function>
+***/
+
 #include "asterisk.h"
 
 #if defined(ASTERISK_REGISTER_FILE)
@@ -44,37 +68,135 @@ ASTERISK_REGISTER_FILE()
 ASTERISK_FILE_VERSION(__FILE__, "$Revision: $")
 #endif
 
+#include "asterisk/app.h"               /* for AST_DECLARE_APP_ARGS, etc */
 #include "asterisk/astobj2.h"           /* for ao2_ref */
+#include "asterisk/channel.h"           /* for ast_channel_lock, ast_channel_name */
 #include "asterisk/cli.h"               /* for ast_cli_entry, ast_cli, etc */
 #include "asterisk/codec.h"             /* for ast_codec_get */
+#include "asterisk/config.h"            /* for ast_config_load, etc */
 #include "asterisk/format.h"            /* for ast_format_get_attribute_data */
 #include "asterisk/frame.h"             /* for ast_frame, etc */
+#include "asterisk/framehook.h"         /* for ast_framehook_attach */
 #include "asterisk/linkedlists.h"       /* for AST_LIST_NEXT, etc */
 #include "asterisk/lock.h"              /* for ast_atomic_fetchadd_int */
-#include "asterisk/logger.h"            /* for ast_log, LOG_ERROR, etc */
+#include "asterisk/logger.h"            /* for ast_log, ast_read_threadstorage_callid */
 #include "asterisk/module.h"
+#include "asterisk/pbx.h"               /* for ast_custom_function */
+#include "asterisk/sched.h"             /* for ast_sched_add */
+#include "asterisk/strings.h"           /* for ast_strip, ast_strlen_zero */
+#include "asterisk/time.h"              /* for ast_tvnow, ast_tvdiff_ms */
 #include "asterisk/translate.h"         /* for ast_trans_pvt, etc */
+#include "asterisk/ulaw.h"              /* for AST_LIN2MU, AST_MULAW */
+#include "asterisk/alaw.h"              /* for AST_LIN2A, AST_ALAW */
 #include "asterisk/utils.h"             /* for ARRAY_LEN */
 
+#include <errno.h>                      /* for errno */
+#include <math.h>                       /* for log10 */
+#include <sched.h>                      /* for SCHED_BATCH */
+#include <stdio.h>                      /* for FILE, setvbuf */
+#include <sys/resource.h>               /* for getrusage, setpriority */
+#include <time.h>                       /* for clock_gettime */
+#if defined(__linux__)
+#include <linux/perf_event.h>           /* for perf_event_attr */
+#include <sys/syscall.h>                /* for __NR_perf_event_open */
+#endif
+
 #include <opus/opus.h>
 
-#include "asterisk/opus.h"              /* for CODEC_OPUS_DEFAULT_* */
+#include "asterisk/opus.h"              /* for CODEC_OPUS_DEFAULT_*, ast_opus_activity */
 
-#define	BUFFER_SAMPLES	5760
-#define	MAX_CHANNELS	2
 #define	OPUS_SAMPLES	960
 
+/* Private structures and the decoding path */
+#include "opus_decode.h"
+
 /* Sample frame data */
 #include "asterisk/slin.h"
 #include "ex_opus.h"
+#include "ex_slin.h"
+
+/* G.711 samples for the fused translators, companded from the slin sample */
+static uint8_t ex_ulaw[160];
+static uint8_t ex_alaw[160];
+
+static void g711_sample_init(void)
+{
+	const struct ast_frame *slin = slin8_sample();
+	const int16_t *src = slin->data.ptr;
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(ex_ulaw) && i < slin->samples; i++) {
+		ex_ulaw[i] = AST_LIN2MU(src[i]);
+		ex_alaw[i] = AST_LIN2A(src[i]);
+	}
+}
+
+static struct ast_frame *ulaw_sample(void)
+{
+	static struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = sizeof(ex_ulaw),
+		.samples = ARRAY_LEN(ex_ulaw),
+		.mallocd = 0,
+		.offset = 0,
+		.src = __PRETTY_FUNCTION__,
+		.data.ptr = ex_ulaw,
+	};
+
+	f.subclass.format = ast_format_ulaw;
+
+	return &f;
+}
+
+static struct ast_frame *alaw_sample(void)
+{
+	static struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = sizeof(ex_alaw),
+		.samples = ARRAY_LEN(ex_alaw),
+		.mallocd = 0,
+		.offset = 0,
+		.src = __PRETTY_FUNCTION__,
+		.data.ptr = ex_alaw,
+	};
+
+	f.subclass.format = ast_format_alaw;
+
+	return &f;
+}
+
+/* The sampling rates of Opus, which its encoders and decoders run at */
+static const int opus_rates[] = { 8000, 12000, 16000, 24000, 48000, };
 
 static struct codec_usage {
 	int encoder_id;
 	int decoder_id;
 	int encoders;
 	int decoders;
+	int encoders_at[ARRAY_LEN(opus_rates)];	/* per rate, for 'opus capacity' */
+	int decoders_at[ARRAY_LEN(opus_rates)];
 } usage;
 
+static int opus_rate_index(int sampling_rate)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(opus_rates) - 1 && opus_rates[i] < sampling_rate; i++) {
+	}
+
+	return i;
+}
+
+/* Cost of the last load, see load_module() */
+static int load_registered;
+static long load_ms;
+
+/* Decoders rest while the sender is silent, see opus_decode_slot() */
+static int skip_silence;
+
+/* Decoders hand out frames of this duration, see opustolin_frameout() */
+static int decoder_frame_ms = 20;
+
 /*
  * Stores the function pointer 'sample_count' of the cached ast_codec
  * before this module was loaded. Allows to restore this previous
@@ -83,497 +205,2446 @@ static struct codec_usage {
 static struct ast_codec *opus_codec; /* codec of the cached format */
 static int (*opus_samples_previous)(struct ast_frame *frame);
 
-/* Private structures */
-struct opus_coder_pvt {
-	void *opus;	/* May be encoder or decoder */
-	int sampling_rate;
-	int multiplier;
-	int id;
-	int16_t buf[BUFFER_SAMPLES];
-	int framesize;
-	int inited;
-	int channels;
-	int decode_fec_incoming;
-	int previous_lost;
+/* Helper methods */
+static const struct opus_attr default_attr = {
+	.maxbitrate  = CODEC_OPUS_DEFAULT_BITRATE,
+	.maxplayrate = CODEC_OPUS_DEFAULT_MAX_PLAYBACK_RATE,
+	.stereo      = CODEC_OPUS_DEFAULT_STEREO,
+	.cbr         = CODEC_OPUS_DEFAULT_CBR,
+	.fec         = CODEC_OPUS_DEFAULT_FEC,
+	.dtx         = CODEC_OPUS_DEFAULT_DTX,
+	.spropstereo = CODEC_OPUS_DEFAULT_STEREO,
+	.complexity    = -1,
+	.application   = -1,
+	.signal        = -1,
+	.frameduration = -1,
+	.packetloss    = -1,
 };
 
-struct opus_attr {
-	unsigned int maxbitrate;
-	unsigned int maxplayrate;
-	unsigned int unused; /* was minptime */
-	unsigned int stereo;
-	unsigned int cbr;
-	unsigned int fec;
-	unsigned int dtx;
-	unsigned int spropmaxcapturerate; /* FIXME: not utilised, yet */
-	unsigned int spropstereo; /* FIXME: currently, we are just mono */
+/* In the order of CODEC_OPUS_APPLICATION_* and CODEC_OPUS_SIGNAL_* */
+static const int opus_applications[] = {
+	OPUS_APPLICATION_VOIP,
+	OPUS_APPLICATION_AUDIO,
+	OPUS_APPLICATION_RESTRICTED_LOWDELAY,
+};
+static const int opus_signals[] = {
+	OPUS_AUTO,
+	OPUS_SIGNAL_VOICE,
+	OPUS_SIGNAL_MUSIC,
 };
 
-/* Helper methods */
-static int opus_encoder_construct(struct ast_trans_pvt *pvt, int sampling_rate)
-{
-	struct opus_coder_pvt *opvt = pvt->pvt;
-	struct opus_attr *attr = pvt->explicit_dst ? ast_format_get_attribute_data(pvt->explicit_dst) : NULL;
-	const opus_int32 bitrate = attr ? attr->maxbitrate  : CODEC_OPUS_DEFAULT_BITRATE;
-	const int maxplayrate    = attr ? attr->maxplayrate : CODEC_OPUS_DEFAULT_MAX_PLAYBACK_RATE;
-	const int channels       = attr ? attr->stereo + 1  : CODEC_OPUS_DEFAULT_STEREO + 1;
-	const opus_int32 vbr     = attr ? !(attr->cbr)      : !CODEC_OPUS_DEFAULT_CBR;
-	const opus_int32 fec     = attr ? attr->fec         : CODEC_OPUS_DEFAULT_FEC;
-	const opus_int32 dtx     = attr ? attr->dtx         : CODEC_OPUS_DEFAULT_DTX;
-	const int application    = OPUS_APPLICATION_VOIP;
-	int status = 0;
+#define	DEFAULT_PROFILE { \
+	.application = OPUS_APPLICATION_VOIP, \
+	.complexity = -1, \
+	.signal = OPUS_AUTO, \
+	.frame_duration = 20, \
+	.bitrate = 0, \
+	.packet_loss = 0, \
+}
 
-	opvt->opus = opus_encoder_create(sampling_rate, channels, application, &status);
+static const struct opus_profile default_profile = DEFAULT_PROFILE;
 
-	if (status != OPUS_OK) {
-		ast_log(LOG_ERROR, "Error creating the Opus encoder: %s\n", opus_strerror(status));
-		return -1;
-	}
+/*
+ * The profile for new encoders. Each reload bumps the generation; running
+ * encoders compare it, and follow when reconfigure_running is set.
+ */
+static struct opus_profile profile = DEFAULT_PROFILE;
+static unsigned int profile_generation;
+static int reconfigure_running;
+AST_RWLOCK_DEFINE_STATIC(profile_lock);
 
-	if (sampling_rate <= 8000 || maxplayrate <= 8000) {
-		status = opus_encoder_ctl(opvt->opus, OPUS_SET_MAX_BANDWIDTH(OPUS_BANDWIDTH_NARROWBAND));
-	} else if (sampling_rate <= 12000 || maxplayrate <= 12000) {
-		status = opus_encoder_ctl(opvt->opus, OPUS_SET_MAX_BANDWIDTH(OPUS_BANDWIDTH_MEDIUMBAND));
-	} else if (sampling_rate <= 16000 || maxplayrate <= 16000) {
-		status = opus_encoder_ctl(opvt->opus, OPUS_SET_MAX_BANDWIDTH(OPUS_BANDWIDTH_WIDEBAND));
-	} else if (sampling_rate <= 24000 || maxplayrate <= 24000) {
-		status = opus_encoder_ctl(opvt->opus, OPUS_SET_MAX_BANDWIDTH(OPUS_BANDWIDTH_SUPERWIDEBAND));
-	} /* else we use the default: OPUS_BANDWIDTH_FULLBAND */
+static unsigned int opus_encoder_profile(struct opus_profile *dst)
+{
+	unsigned int generation;
 
-	if (0 < bitrate && bitrate != 510000) {
-		status = opus_encoder_ctl(opvt->opus, OPUS_SET_BITRATE(bitrate));
-	} /* else we use the default: OPUS_AUTO */
-	status = opus_encoder_ctl(opvt->opus, OPUS_SET_VBR(vbr));
-	status = opus_encoder_ctl(opvt->opus, OPUS_SET_INBAND_FEC(fec));
-	status = opus_encoder_ctl(opvt->opus, OPUS_SET_DTX(dtx));
+	ast_rwlock_rdlock(&profile_lock);
+	*dst = profile;
+	generation = profile_generation;
+	ast_rwlock_unlock(&profile_lock);
 
-	opvt->sampling_rate = sampling_rate;
-	opvt->multiplier = 48000 / sampling_rate;
-	opvt->framesize = sampling_rate / 50;
-	opvt->id = ast_atomic_fetchadd_int(&usage.encoder_id, 1) + 1;
+	return generation;
+}
 
-	ast_atomic_fetchadd_int(&usage.encoders, +1);
+/*! \brief Restricted low-delay can be chosen on creation of an encoder only */
+static inline int opus_lowdelay(const struct opus_profile *prof)
+{
+	return prof->application == OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+}
 
-	ast_debug(3, "Created encoder #%d (%d -> opus)\n", opvt->id, sampling_rate);
+/*!
+ * \brief The profile, with the encoder settings of the format attributes instead, where set
+ *
+ * The attributes come per endpoint via ast_format_attribute_set(), for
+ * example complexity 10 for some and 3 for others. Values out of range get
+ * ignored; res_format_attr_opus rejects them anyway.
+ */
+static void opus_encoder_settings(struct opus_profile *dst, const struct opus_profile *prof, const struct opus_attr *attr)
+{
+	*dst = *prof;
 
-	return 0;
+	if (0 <= attr->complexity && attr->complexity <= 10) {
+		dst->complexity = attr->complexity;
+	}
+	if (0 <= attr->application && attr->application < ARRAY_LEN(opus_applications)) {
+		dst->application = opus_applications[attr->application];
+	}
+	if (0 <= attr->signal && attr->signal < ARRAY_LEN(opus_signals)) {
+		dst->signal = opus_signals[attr->signal];
+	}
+	if (attr->frameduration == 10 || attr->frameduration == 20
+		|| attr->frameduration == 40 || attr->frameduration == 60) {
+		dst->frame_duration = attr->frameduration;
+	}
+	if (0 <= attr->packetloss && attr->packetloss <= 100) {
+		dst->packet_loss = attr->packetloss;
+	}
 }
 
-static int opus_decoder_construct(struct ast_trans_pvt *pvt, struct ast_frame *f)
+static const struct opus_attr *opus_encoder_attr(struct ast_trans_pvt *pvt)
 {
-	struct opus_coder_pvt *opvt = pvt->pvt;
-	/* struct opus_attr *attr = ast_format_get_attribute_data(f->subclass.format); */
-	int error = 0;
-
-	opvt->sampling_rate = pvt->t->dst_codec.sample_rate;
-	opvt->multiplier = 48000 / opvt->sampling_rate;
-	opvt->channels = /* attr ? attr->spropstereo + 1 :*/ 1; /* FIXME */
+	struct opus_attr *attr = pvt->explicit_dst ? ast_format_get_attribute_data(pvt->explicit_dst) : NULL;
 
-	opvt->opus = opus_decoder_create(opvt->sampling_rate, opvt->channels, &error);
+	return attr ? attr : &default_attr;
+}
 
-	if (error != OPUS_OK) {
-		ast_log(LOG_ERROR, "Error creating the Opus decoder: %s\n", opus_strerror(error));
-		return -1;
+static int opus_max_bandwidth(int sampling_rate, int maxplayrate)
+{
+	if (sampling_rate <= 8000 || maxplayrate <= 8000) {
+		return OPUS_BANDWIDTH_NARROWBAND;
+	} else if (sampling_rate <= 12000 || maxplayrate <= 12000) {
+		return OPUS_BANDWIDTH_MEDIUMBAND;
+	} else if (sampling_rate <= 16000 || maxplayrate <= 16000) {
+		return OPUS_BANDWIDTH_WIDEBAND;
+	} else if (sampling_rate <= 24000 || maxplayrate <= 24000) {
+		return OPUS_BANDWIDTH_SUPERWIDEBAND;
 	}
 
-	opvt->id = ast_atomic_fetchadd_int(&usage.decoder_id, 1) + 1;
+	return OPUS_BANDWIDTH_FULLBAND;
+}
 
-	ast_atomic_fetchadd_int(&usage.decoders, +1);
+/*! \brief The bitrate of the profile, if any, but not above the negotiated one */
+static int opus_bitrate(const struct opus_attr *attr, const struct opus_profile *prof)
+{
+	const int negotiated = (0 < attr->maxbitrate && attr->maxbitrate != 510000) ? attr->maxbitrate : 0;
 
-	ast_debug(3, "Created decoder #%d (opus -> %d)\n", opvt->id, opvt->sampling_rate);
+	if (prof->bitrate && (!negotiated || prof->bitrate < negotiated)) {
+		return prof->bitrate;
+	}
 
-	return 0;
+	return negotiated ? negotiated : OPUS_AUTO;
 }
 
-/* Translator callbacks */
-static int lintoopus_new(struct ast_trans_pvt *pvt)
+/*!
+ * \brief Apply the attributes and settings which differ from those applied already
+ *
+ * A new encoder has none applied, therefore it gets everything. A running
+ * encoder just gets the deltas and keeps its state.
+ */
+static void opus_encoder_configure(struct opus_coder_pvt *opvt, const struct opus_attr *attr, const struct opus_profile *base)
 {
-	return opus_encoder_construct(pvt, pvt->t->src_codec.sample_rate);
-}
+	const struct opus_attr *applied = opvt->configured ? &opvt->applied : NULL;
+	const struct opus_profile *current = NULL;
+	struct opus_profile settings;
+	struct opus_profile previous;
+	const struct opus_profile *prof = &settings;
+
+	opus_encoder_settings(&settings, base, attr);
+	if (applied) {
+		opus_encoder_settings(&previous, &opvt->profile, applied);
+		current = &previous;
+	}
 
-static int opustolin_new(struct ast_trans_pvt *pvt)
-{
-	struct opus_coder_pvt *opvt = pvt->pvt;
+	if (current && current->application != prof->application) {
+		/* VoIP <-> Audio; a change to or from low-delay re-created the encoder */
+		opus_encoder_ctl(opvt->opus, OPUS_SET_APPLICATION(prof->application));
+	}
+	if (0 <= prof->complexity && (!current || current->complexity != prof->complexity)) {
+		/* once set, removing the setting affects new encoders only */
+		opus_encoder_ctl(opvt->opus, OPUS_SET_COMPLEXITY(prof->complexity));
+	}
+	if (!current || current->signal != prof->signal) {
+		opus_encoder_ctl(opvt->opus, OPUS_SET_SIGNAL(prof->signal));
+	}
+	if (!current || current->packet_loss != prof->packet_loss) {
+		opus_encoder_ctl(opvt->opus, OPUS_SET_PACKET_LOSS_PERC(prof->packet_loss));
+	}
+	opvt->framesize = opvt->sampling_rate * prof->frame_duration / 1000;
 
-	opvt->previous_lost = 0; /* we are new and have not lost anything */
-	opvt->inited = 0; /* we do not know the "sprop" values, yet */
+	if (!applied || applied->maxplayrate != attr->maxplayrate) {
+		opus_encoder_ctl(opvt->opus, OPUS_SET_MAX_BANDWIDTH(opus_max_bandwidth(opvt->sampling_rate, attr->maxplayrate)));
+	}
+	if (!applied || opus_bitrate(applied, current) != opus_bitrate(attr, prof)) {
+		opus_encoder_ctl(opvt->opus, OPUS_SET_BITRATE(opus_bitrate(attr, prof)));
+	}
+	if (!applied || applied->cbr != attr->cbr) {
+		opus_encoder_ctl(opvt->opus, OPUS_SET_VBR(!attr->cbr));
+	}
+	if (!applied || applied->fec != attr->fec) {
+		opus_encoder_ctl(opvt->opus, OPUS_SET_INBAND_FEC(attr->fec));
+	}
+	if (!applied || applied->dtx != attr->dtx) {
+		opus_encoder_ctl(opvt->opus, OPUS_SET_DTX(attr->dtx));
+	}
 
-	return 0;
+	if (applied) {
+		ast_debug(3, "Reconfigured encoder #%d\n", opvt->id);
+	}
+	opvt->applied = *attr;
+	opvt->profile = *base;
+	opvt->configured = 1;
 }
 
-static int lintoopus_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
+/*
+ * Voice activity of the encoders, for bridges and mixers which would run
+ * their own talk detection otherwise: the level of each encoded frame in
+ * -dBov, like the audio level of RFC 6464, and whether it carries voice.
+ * With DTX, the encoder knows the latter from its own analysis; otherwise,
+ * the level decides.
+ */
+#define	ACTIVITY_LEVEL	50	/* -dBov; quieter is silence */
+
+static void opus_encoder_activity(struct opus_coder_pvt *opvt, const int16_t *samples)
 {
-	struct opus_coder_pvt *opvt = pvt->pvt;
+	const int count = opvt->framesize * opvt->channels;
+	long long energy = 0;
+	int level = 127;
+	int active;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		energy += samples[i] * samples[i];
+	}
+	if (energy) {
+		level = -10 * log10((double) energy / count / (32768.0 * 32768.0));
+		level = MIN(MAX(level, 0), 127);
+	}
+	active = level <= ACTIVITY_LEVEL;
 
-	/* XXX We should look at how old the rest of our stream is, and if it
-	   is too old, then we should overwrite it entirely, otherwise we can
-	   get artifacts of earlier talk that do not belong */
-	memcpy(opvt->buf + pvt->samples, f->data.ptr, f->datalen);
-	pvt->samples += f->samples;
+#if defined(OPUS_GET_IN_DTX_REQUEST)
+	if (opvt->applied.dtx) {
+		opus_int32 in_dtx;
 
-	return 0;
-}
+		if (opus_encoder_ctl(opvt->opus, OPUS_GET_IN_DTX(&in_dtx)) == OPUS_OK) {
+			active = !in_dtx;
+		}
+	}
+#endif
 
-static struct ast_frame *lintoopus_frameout(struct ast_trans_pvt *pvt)
-{
-	struct opus_coder_pvt *opvt = pvt->pvt;
-	struct ast_frame *result = NULL;
-	struct ast_frame *last = NULL;
-	int samples = 0; /* output samples */
+	/* one store, so a reader in another thread never sees half of it */
+	__atomic_store_n(&opvt->activity, level << 1 | active, __ATOMIC_RELAXED);
+}
 
-	while (pvt->samples >= opvt->framesize) {
-		/* status is either error or output bytes */
-		const int status = opus_encode(opvt->opus,
-			opvt->buf + samples,
-			opvt->framesize,
-			pvt->outbuf.uc,
-			BUFFER_SAMPLES);
+/*
+ * When a translation path gets rebuilt, for example on re-INVITE or when a
+ * bridge changes, the channel thread frees the old path and builds the new
+ * one right away. An encoder released that way is parked shortly, and the
+ * next encoder with the same sample rate and channel count which is built
+ * by the same thread for the same call takes it over, instead of constructing
+ * a new one. It keeps its state, therefore the transition is not audible.
+ * The call is the call ID of the thread; a thread without one, for example a
+ * mixing thread which builds paths for many channels, does not park, so the
+ * audio history of one call never reaches another. Because the low-delay
+ * mode is fixed on creation, it has to match as well. A timer destroys the
+ * encoders which nobody took over.
+ */
+#define	PARKED_ENCODERS	16
+#define	PARKED_MS	20
+
+struct opus_parked_encoder {
+	OpusEncoder *opus;
+	pthread_t thread;
+	ast_callid callid;
+	struct timeval since;
+	int sampling_rate;
+	int channels;
+	struct opus_attr applied;
+	struct opus_profile profile;
+	int lowdelay;
+};
 
-		samples += opvt->framesize;
-		pvt->samples -= opvt->framesize;
+static struct opus_parked_encoder parked[PARKED_ENCODERS];
+static struct ast_sched_context *parked_sched;
+static int parked_timer = -1;
+AST_MUTEX_DEFINE_STATIC(parked_lock);
 
-		if (status < 0) {
-			ast_log(LOG_ERROR, "Error encoding the Opus frame: %s\n", opus_strerror(status));
-		} else {
-			struct ast_frame *current = ast_trans_frameout(pvt,
-				status,
-				OPUS_SAMPLES);
+/*! \note Call with parked_lock held */
+static void opus_encoder_parked_expire(int all)
+{
+	const struct timeval now = ast_tvnow();
+	int i;
 
-			if (!current) {
-				continue;
-			} else if (last) {
-				AST_LIST_NEXT(last, frame_list) = current;
-			} else {
-				result = current;
-			}
-			last = current;
+	for (i = 0; i < ARRAY_LEN(parked); i++) {
+		if (parked[i].opus && (all || PARKED_MS < ast_tvdiff_ms(now, parked[i].since))) {
+			opus_encoder_destroy(parked[i].opus);
+			parked[i].opus = NULL;
 		}
 	}
+}
 
-	/* Move the data at the end of the buffer to the front */
-	if (samples) {
-		memmove(opvt->buf, opvt->buf + samples, pvt->samples * 2);
+/*! \brief Expire parked encoders, again and again while any is left */
+static int opus_encoder_parked_timer(const void *data)
+{
+	int i;
+
+	ast_mutex_lock(&parked_lock);
+	opus_encoder_parked_expire(0);
+	for (i = 0; i < ARRAY_LEN(parked) && !parked[i].opus; i++) {
+	}
+	if (i == ARRAY_LEN(parked)) {
+		parked_timer = -1;
 	}
+	ast_mutex_unlock(&parked_lock);
 
-	return result;
+	return i < ARRAY_LEN(parked);
 }
 
-static int opustolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
+static int opus_encoder_park(struct opus_coder_pvt *opvt)
 {
-	struct opus_coder_pvt *opvt = pvt->pvt;
-	int decode_fec;
-	int frame_size;
-	opus_int16 *dst;
-	opus_int32 len;
-	unsigned char *src;
-	int status;
+	const ast_callid callid = ast_read_threadstorage_callid();
+	struct opus_profile settings;
+	int i;
 
-	if (!opvt->inited && f->datalen == 0) {
-		return 0; /* we cannot start without data */
-	} else if (!opvt->inited) { /* 0 < f->datalen */
-		status = opus_decoder_construct(pvt, f);
-		opvt->inited = 1;
-		if (status) {
-			return status;
-		}
+	if (!callid || !parked_sched) {
+		return -1;
 	}
+	opus_encoder_settings(&settings, &opvt->profile, &opvt->applied);
 
-	/*
-	 * When we get a frame indicator (ast_null_frame), format is NULL. Because FEC
-	 * status can change any time (SDP re-negotiation), we save again and again.
-	 */
-	if (f->subclass.format) {
-		struct opus_attr *attr = ast_format_get_attribute_data(f->subclass.format);
-
-		if (attr) {
-			opvt->decode_fec_incoming = attr->fec;
+	ast_mutex_lock(&parked_lock);
+	opus_encoder_parked_expire(0);
+	if (parked_timer < 0) {
+		parked_timer = ast_sched_add(parked_sched, PARKED_MS, opus_encoder_parked_timer, NULL);
+	}
+	for (i = 0; i < ARRAY_LEN(parked); i++) {
+		if (!parked[i].opus && 0 <= parked_timer) {
+			parked[i].opus = opvt->opus;
+			parked[i].thread = pthread_self();
+			parked[i].callid = callid;
+			parked[i].since = ast_tvnow();
+			parked[i].sampling_rate = opvt->sampling_rate;
+			parked[i].channels = opvt->channels;
+			parked[i].applied = opvt->applied;
+			parked[i].profile = opvt->profile;
+			parked[i].lowdelay = opus_lowdelay(&settings);
+			break;
 		}
 	}
-	decode_fec = opvt->decode_fec_incoming;
+	ast_mutex_unlock(&parked_lock);
 
-	/*
-	 * The Opus Codec, actually its library allows
-	 * - Forward-Error Correction (FEC), and
-	 * - native Packet-Loss Concealment (PLC).
-	 * The sender might include FEC. If there is no FEC, because it was not send
-	 * or the FEC data got lost, the API of the Opus library does PLC instead.
-	 * Therefore we have three boolean variables:
-	 * - current frame got lost: f->datalen == 0,
-	 * - previous frame got lost: opvt->previous_lost, and
-	 * - FEC negotiated on SDP layer: decode_fec.
-	 * Now, we go through all cases. Because some cases use the same source code
-	 * we have less than 8 (2^3) cases.
-	 *
-	 * Some notes on the coding style of this section:
-	 * This code section is passed for each incoming frame, normally every
-	 * 20 milliseconds. For each channel, this code is passed individually.
-	 * Therefore, this code should be as performant as possible. On the other
-	 * hand, PLC plus FEC is complicated. Therefore, code readability is one
-	 * prerequisite to understand, debug, and review this code section. Because
-	 * we do have optimising compilers, we are able to sacrify optimised code
-	 * for code readability. If you find an error or unnecessary calculation
-	 * which is not optimised = removed by your compiler, please, create an
-	 * issue on <https://github.com/traud/asterisk-opus/issues>. I am just
-	 * a human and human do mistakes. However, humans love to learn.
-	 *
-	 * Source-code examples are
-	 * - <https://git.xiph.org/?p=opus.git;a=history;f=src/opus_demo.c>,
-	 * - <https://freeswitch.org/stash/projects/FS/repos/freeswitch/browse/src/mod/codecs/mod_opus/mod_opus.c>
-	 * and the official mailing list itself:
-	 * <https://www.google.de/search?q=site:lists.xiph.org+opus>.
-	 */
+	return i < ARRAY_LEN(parked) ? 0 : -1;
+}
 
-	/* Case 1 and 2 */
-	if (f->datalen == 0 && opvt->previous_lost) {
-		/*
-		 * If this frame and the previous frame got lost, we do not have any
-		 * data for FEC. Therefore, we go for PLC on the previous frame. However,
-		 * the next frame could include FEC for the currently lost frame.
-		 * Therefore, we "wait" for the next frame to fix the current frame.
-		 */
-		decode_fec = 0; /* = do PLC */
-		opus_decoder_ctl(opvt->opus, OPUS_GET_LAST_PACKET_DURATION(&frame_size));
-		dst = pvt->outbuf.i16 + (pvt->samples * opvt->channels);
-		len = 0;
-		src = NULL;
-		status = opus_decode(opvt->opus, src, len, dst, frame_size, decode_fec);
-		if (status < 0) {
-			ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
-		} else {
-			pvt->samples += status;
-			pvt->datalen += status * opvt->channels * sizeof(int16_t);
-		}
-		/*
-		 * Save the state of the current frame, whether it is lost = "wait".
-		 * That way, we are able to decide whether to do FEC next time.
-		 */
-		opvt->previous_lost = (f->datalen == 0 || status < 0);
-		return 0;
-	}
+static int opus_encoder_unpark(struct opus_coder_pvt *opvt, int sampling_rate, int channels, int lowdelay)
+{
+	const ast_callid callid = ast_read_threadstorage_callid();
+	int i;
 
-	/* Case 3 */
-	if (f->datalen == 0 && !decode_fec) { /* !opvt->previous_lost */
-		/*
-		 * The sender stated in SDP: "I am not going to provide FEC". Therefore,
-		 * we do not wait for the next frame and do PLC right away.
-		 */
-		decode_fec = 0;
-		opus_decoder_ctl(opvt->opus, OPUS_GET_LAST_PACKET_DURATION(&frame_size));
-		dst = pvt->outbuf.i16 + (pvt->samples * opvt->channels);
-		len = f->datalen;
-		src = NULL;
-		status = opus_decode(opvt->opus, src, len, dst, frame_size, decode_fec);
-		if (status < 0) {
-			ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
-		} else {
-			pvt->samples += status;
-			pvt->datalen += status * opvt->channels * sizeof(int16_t);
-		}
-		opvt->previous_lost = (f->datalen == 0 || status < 0);
-		return 0;
+	if (!callid) {
+		return -1;
 	}
 
-	/* Case 4 */
-	if (f->datalen == 0) { /* decode_fec && !opvt->previous_lost */
-		/*
-		 * The previous frame was of no issue. Therefore, we do not have to
-		 * reconstruct it. We do not have any data in the current frame but the
-		 * sender might give us FEC with the next frame. We cannot do anything
-		 * but wait for the next frame. Till Asterisk 13.7, this creates the
-		 * warning "opustolin48 did not update samples 0". Please, ignore this
-		 * warning or apply the patch included in the GitHub repository.
-		 */
-		status = 0; /* no samples to add currently */
-		if (status < 0) {
-			ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
-		} else {
-			pvt->samples += status;
-			pvt->datalen += status * opvt->channels * sizeof(int16_t);
+	ast_mutex_lock(&parked_lock);
+	opus_encoder_parked_expire(0);
+	for (i = 0; i < ARRAY_LEN(parked); i++) {
+		if (parked[i].opus
+			&& pthread_equal(parked[i].thread, pthread_self())
+			&& parked[i].callid == callid
+			&& parked[i].sampling_rate == sampling_rate
+			&& parked[i].channels == channels
+			&& parked[i].lowdelay == lowdelay) {
+			opvt->opus = parked[i].opus;
+			opvt->applied = parked[i].applied;
+			opvt->profile = parked[i].profile;
+			opvt->configured = 1;
+			parked[i].opus = NULL;
+			break;
 		}
-		opvt->previous_lost = (f->datalen == 0 || status < 0);
-		return 0;
 	}
+	ast_mutex_unlock(&parked_lock);
 
-	/* Case 5 and 6 */
-	if (!opvt->previous_lost) { /* 0 < f->datalen */
-		/*
-		 * The perfect case - the previous frame was not lost and we have data
-		 * in the current frame. Therefore, neither FEC nor PLC are required.
-		 */
-		decode_fec = 0;
-		frame_size = BUFFER_SAMPLES / opvt->multiplier; /* parse everything */
-		dst = pvt->outbuf.i16 + (pvt->samples * opvt->channels);
-		len = f->datalen;
-		src = f->data.ptr;
-		status = opus_decode(opvt->opus, src, len, dst, frame_size, decode_fec);
-		if (status < 0) {
-			ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
-		} else {
-			pvt->samples += status;
-			pvt->datalen += status * opvt->channels * sizeof(int16_t);
-		}
-		opvt->previous_lost = (f->datalen == 0 || status < 0);
-		return 0;
-	}
+	return opvt->opus ? 0 : -1;
+}
 
-	/* Case 7 */
-	if (!decode_fec) { /* 0 < f->datalen && opvt->previous_lost */
-		/*
-		 * The previous frame got lost and the sender stated in SDP: "I am not
-		 * going to provide FEC". Therefore, we do PLC. Furthermore, we try to
-		 * decode the current frame because we have data. This creates jitter
-		 * because we create double the amount of frames as normal, see
-		 * <https://issues.asterisk.org/jira/browse/ASTERISK-25483>. If this is
-		 * an issue for your use-case, please, file and issue report on
-		 * <https://github.com/traud/asterisk-opus/issues>.
-		 */
-		decode_fec = 0;
-		opus_decoder_ctl(opvt->opus, OPUS_GET_LAST_PACKET_DURATION(&frame_size));
-		dst = pvt->outbuf.i16 + (pvt->samples * opvt->channels);
-		len = 0;
-		src = NULL;
-		status = opus_decode(opvt->opus, src, len, dst, frame_size, decode_fec);
-		if (status < 0) {
-			ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
-		} else {
-			pvt->samples += status;
-			pvt->datalen += status * opvt->channels * sizeof(int16_t);
-		}
-		decode_fec = 0;
-		frame_size = BUFFER_SAMPLES / opvt->multiplier; /* parse everything */
-		dst = pvt->outbuf.i16 + (pvt->samples * opvt->channels); /* append after PLC data */
-		len = f->datalen;
-		src = f->data.ptr;
-		status = opus_decode(opvt->opus, src, len, dst, frame_size, decode_fec);
-		if (status < 0) {
-			ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
-		} else {
-			pvt->samples += status;
-			pvt->datalen += status * opvt->channels * sizeof(int16_t);
-		}
-		opvt->previous_lost = (f->datalen == 0 || status < 0);
-		return 0;
-	}
+/*
+ * Flight recorder: each encoder and decoder keeps its last FLIGHT_EVENTS
+ * frames, about five seconds at 20 ms, in a ring allocated together with
+ * the translator. Only the thread of the translator writes it; a reader
+ * copies it without stopping the writer and drops what the writer might
+ * have overwritten meanwhile, see opus_flight_copy(). A frame which took
+ * longer than flight_budget_us writes the ring to the log, at most once per
+ * FLIGHT_DUMP_MS and encoder or decoder.
+ */
+#define	FLIGHT_EVENTS	256
+#define	FLIGHT_DUMP_MS	10000
+
+enum opus_flight_kind {
+	FLIGHT_ENCODE = 1 << 0,
+	FLIGHT_DECODE = 1 << 1,
+	FLIGHT_FEC = 1 << 2,
+	FLIGHT_PLC = 1 << 3,
+	FLIGHT_NOISE = 1 << 4,
+	FLIGHT_ERROR = 1 << 5,
+};
 
-	/* Case 8; Last Case */
-	{ /* 0 < f->datalen && opvt->previous_lost && decode_fec */
-		decode_fec = 1;
-		opus_decoder_ctl(opvt->opus, OPUS_GET_LAST_PACKET_DURATION(&frame_size));
-		dst = pvt->outbuf.i16 + (pvt->samples * opvt->channels);
-		len = f->datalen;
-		src = f->data.ptr;
-		status = opus_decode(opvt->opus, src, len, dst, frame_size, decode_fec);
-		if (status < 0) {
-			ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
-		} else {
-			pvt->samples += status;
-			pvt->datalen += status * opvt->channels * sizeof(int16_t);
-		}
-		decode_fec = 0;
-		frame_size = BUFFER_SAMPLES / opvt->multiplier; /* parse everything */
-		dst = pvt->outbuf.i16 + (pvt->samples * opvt->channels); /* append after FEC data */
-		len = f->datalen;
-		src = f->data.ptr;
-		status = opus_decode(opvt->opus, src, len, dst, frame_size, decode_fec);
-		if (status < 0) {
-			ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
-		} else {
-			pvt->samples += status;
-			pvt->datalen += status * opvt->channels * sizeof(int16_t);
-		}
-		opvt->previous_lost = (f->datalen == 0 || status < 0);
-		return 0;
+struct opus_flight_event {
+	long long arrival_ns;	/* CLOCK_MONOTONIC */
+	int ns;			/* spent in the translator */
+	int seqno;		/* decoder only */
+	int bytes;
+	int samples;		/* produced */
+	unsigned int kind;
+};
+
+struct opus_flight {
+	AST_LIST_ENTRY(opus_flight) list;
+	struct opus_coder_pvt *opvt;
+	int encoder;
+	long long dumped_ns;
+	unsigned int head;	/* events written so far */
+	struct opus_flight_event events[FLIGHT_EVENTS];
+};
+
+static AST_LIST_HEAD_STATIC(flights, opus_flight);
+static int flight_budget_us;
+
+static int opus_flight_new(struct opus_coder_pvt *opvt, int encoder)
+{
+	struct opus_flight *flight = ast_calloc(1, sizeof(*flight));
+
+	if (!flight) {
+		return -1;
 	}
+	flight->opvt = opvt;
+	flight->encoder = encoder;
+	opvt->flight = flight;
+
+	AST_LIST_LOCK(&flights);
+	AST_LIST_INSERT_TAIL(&flights, flight, list);
+	AST_LIST_UNLOCK(&flights);
+
+	return 0;
 }
 
-static void lintoopus_destroy(struct ast_trans_pvt *arg)
+static void opus_flight_destroy(struct opus_coder_pvt *opvt)
 {
-	struct opus_coder_pvt *opvt = arg->pvt;
-
-	if (!opvt || !opvt->opus) {
+	if (!opvt->flight) {
 		return;
 	}
 
-	opus_encoder_destroy(opvt->opus);
-	opvt->opus = NULL;
-
-	ast_atomic_fetchadd_int(&usage.encoders, -1);
+	/* a reader holds the lock while it copies */
+	AST_LIST_LOCK(&flights);
+	AST_LIST_REMOVE(&flights, opvt->flight, list);
+	AST_LIST_UNLOCK(&flights);
 
-	ast_debug(3, "Destroyed encoder #%d (%d->opus)\n", opvt->id, opvt->sampling_rate);
+	ast_free(opvt->flight);
+	opvt->flight = NULL;
 }
 
-static void opustolin_destroy(struct ast_trans_pvt *arg)
+/*! \brief Copy the ring, oldest first; returns the number of events */
+static int opus_flight_copy(struct opus_flight *flight, struct opus_flight_event *events)
 {
-	struct opus_coder_pvt *opvt = arg->pvt;
+	const unsigned int head = __atomic_load_n(&flight->head, __ATOMIC_ACQUIRE);
+	const unsigned int first = head > FLIGHT_EVENTS ? head - FLIGHT_EVENTS : 0;
+	unsigned int after;
+	unsigned int skip = 0;
+	unsigned int i;
+
+	for (i = first; i < head; i++) {
+		events[i - first] = flight->events[i % FLIGHT_EVENTS];
+	}
 
-	if (!opvt || !opvt->opus) {
-		return;
+	/* The writer is at 'after' now; its slot and older ones are unreliable */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	after = __atomic_load_n(&flight->head, __ATOMIC_RELAXED);
+	if (after - first >= FLIGHT_EVENTS) {
+		skip = MIN(after - first - FLIGHT_EVENTS + 1, head - first);
+		memmove(events, events + skip, (head - first - skip) * sizeof(*events));
 	}
 
-	opus_decoder_destroy(opvt->opus);
-	opvt->opus = NULL;
+	return head - first - skip;
+}
 
-	ast_atomic_fetchadd_int(&usage.decoders, -1);
+static void opus_flight_format(const struct opus_flight_event *e, long long last_ns, char *buf, size_t size)
+{
+	snprintf(buf, size, "%10.3f ms %5d us %4d bytes %5d samples seqno %5d%s%s%s%s%s%s",
+		(e->arrival_ns - last_ns) / 1000000.0, e->ns / 1000, e->bytes, e->samples, e->seqno,
+		e->kind & FLIGHT_ENCODE ? " encode" : "",
+		e->kind & FLIGHT_DECODE ? " decode" : "",
+		e->kind & FLIGHT_FEC ? " fec" : "",
+		e->kind & FLIGHT_PLC ? " plc" : "",
+		e->kind & FLIGHT_NOISE ? " noise" : "",
+		e->kind & FLIGHT_ERROR ? " error" : "");
+}
 
-	ast_debug(3, "Destroyed decoder #%d (opus->%d)\n", opvt->id, opvt->sampling_rate);
+/*! \note Called by the writer itself, when a frame was over the budget */
+static void opus_flight_log(struct opus_flight *flight)
+{
+	struct opus_flight_event events[FLIGHT_EVENTS];
+	const int count = opus_flight_copy(flight, events);
+	char line[128];
+	int i;
+
+	ast_log(LOG_WARNING, "%s #%d (%d Hz): frame took %d us, over the budget of %d us; last %d frames:\n",
+		flight->encoder ? "Encoder" : "Decoder", flight->opvt->id, flight->opvt->sampling_rate,
+		events[count - 1].ns / 1000, flight_budget_us, count);
+	for (i = 0; i < count; i++) {
+		opus_flight_format(&events[i], events[count - 1].arrival_ns, line, sizeof(line));
+		ast_log(LOG_WARNING, "  %s\n", line);
+	}
 }
 
-static char *handle_cli_opus_show(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+static void opus_flight_record(struct opus_coder_pvt *opvt, const struct opus_flight_event *event)
 {
-	struct codec_usage copy;
+	struct opus_flight *flight = opvt->flight;
+	const int budget_us = flight_budget_us;
 
-	switch (cmd) {
-	case CLI_INIT:
-		e->command = "opus show";
-		e->usage =
-			"Usage: opus show\n"
-			"       Displays Opus encoder/decoder utilization.\n";
-		return NULL;
-	case CLI_GENERATE:
-		return NULL;
+	if (!flight) {
+		return;
 	}
 
-	if (a->argc != 2) {
-		return CLI_SHOWUSAGE;
+	flight->events[flight->head % FLIGHT_EVENTS] = *event;
+	__atomic_store_n(&flight->head, flight->head + 1, __ATOMIC_RELEASE);
+
+	if (budget_us && event->ns > budget_us * 1000LL
+		&& event->arrival_ns - flight->dumped_ns > FLIGHT_DUMP_MS * 1000000LL) {
+		flight->dumped_ns = event->arrival_ns;
+		opus_flight_log(flight);
 	}
+}
 
-	copy = usage;
+/*
+ * Tone cache: ringback, busy, and congestion tones of playtones are the
+ * same samples on every channel and in every cadence, because the tone
+ * generator restarts its oscillators with each part of the cadence. For a
+ * frame which was encoded before with the same settings, after the same
+ * frame before it, the encoder gets skipped and the packet of back then
+ * goes out. Frames are known by a hash of their samples, the settings, and
+ * the hash of the frame before, so a packet comes from an encoder in the
+ * same state as far as the frame before can tell. Only frames of low tones
+ * get hashed at all, see opus_tone_candidate(), and only a steady tone,
+ * whose frames repeat, ever hits. Silence is not cached; with DTX, the
+ * encoder sends next to nothing for it, and a cached packet amid silence
+ * would make the encoder start afresh at the next word.
+ * A frame goes into the cache only when it was seen a second time, noted
+ * without a lock in tone_seen; therefore speech, which never repeats,
+ * neither takes the lock nor fills the cache. When uncached audio follows
+ * cached packets, the encoder starts afresh, because its state is from
+ * before the tone.
+ */
+#define	TONE_CACHE_SLOTS	1024	/* power of two */
+#define	TONE_SEEN_SLOTS	65536	/* power of two */
+#define	TONE_PACKET_SIZE	256	/* larger packets are not cached */
+#define	TONE_SILENT	64	/* mean energy per sample, about -63 dBFS */
+#define	TONE_FRESH	2	/* tone_previous of a new encoder; hashes are odd */
+
+struct opus_tone_packet {
+	uint64_t key;
+	int len;
+	unsigned char data[TONE_PACKET_SIZE];
+};
 
-	ast_cli(a->fd, "%d/%d encoders/decoders are in use.\n", copy.encoders, copy.decoders);
+static struct opus_tone_packet tone_packets[TONE_CACHE_SLOTS];
+static uint32_t tone_seen[TONE_SEEN_SLOTS]; /* upper half of the key */
+AST_RWLOCK_DEFINE_STATIC(tone_lock);
+static int tone_cache;
+static int tone_hits;
+static int tone_stored;
 
-	return CLI_SUCCESS;
+static inline uint64_t fnv1a(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ p[i]) * 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/*!
+ * \brief Whether a frame is worth its key: not silent, and mostly below 1 kHz
+ *
+ * Looked at with 8 kHz, the second difference of a tone of 930 Hz keeps a
+ * quarter of its energy, of lower tones less. Speech, with its formants
+ * and its noise above, keeps more. Silence is left to DTX. Cheaper than
+ * the key, and without a write to shared memory.
+ */
+static int opus_tone_candidate(const struct opus_coder_pvt *opvt, const int16_t *samples)
+{
+	const int step = MAX(opvt->sampling_rate / 8000, 1) * opvt->channels;
+	const int count = opvt->framesize * opvt->channels;
+	long long energy = 0;
+	long long rough = 0;
+	int i;
+
+	for (i = 2 * step; i < count; i += step) {
+		const int x = samples[i - step];
+		const int d = samples[i] - 2 * x + samples[i - 2 * step];
+
+		energy += x * x;
+		rough += d * d;
+	}
+
+	return TONE_SILENT * (count / step) <= energy && rough * 4 < energy;
+}
+
+static uint64_t opus_tone_hash(const struct opus_coder_pvt *opvt, const int16_t *samples)
+{
+	return fnv1a(0xcbf29ce484222325ULL, samples, opvt->framesize * opvt->channels * sizeof(*samples)) | 1; /* 0 is unknown */
+}
+
+static uint64_t opus_tone_key(const struct opus_coder_pvt *opvt, uint64_t hash)
+{
+	const int shape[] = { opvt->sampling_rate, opvt->channels, opvt->framesize, };
+
+	hash = fnv1a(hash, &opvt->tone_previous, sizeof(opvt->tone_previous));
+	hash = fnv1a(hash, shape, sizeof(shape));
+	hash = fnv1a(hash, &opvt->applied, sizeof(opvt->applied));
+
+	return fnv1a(hash, &opvt->profile, sizeof(opvt->profile)) | 1; /* 0 is empty */
+}
+
+/*!
+ * \brief Take the packet of a frame from the tone cache
+ *
+ * \param admit set to the key, when the frame should go into the cache
+ * once encoded, otherwise to 0
+ *
+ * \return Length of the packet, or 0 when it is not cached
+ */
+static int opus_tone_get(uint64_t key, unsigned char *dst, uint64_t *admit)
+{
+	struct opus_tone_packet *packet = &tone_packets[key & (TONE_CACHE_SLOTS - 1)];
+	uint32_t *seen = &tone_seen[(key >> 16) & (TONE_SEEN_SLOTS - 1)];
+	int len = 0;
+
+	*admit = 0;
+
+	if (__atomic_load_n(&packet->key, __ATOMIC_RELAXED) == key) {
+		ast_rwlock_rdlock(&tone_lock);
+		if (packet->key == key) {
+			len = packet->len;
+			memcpy(dst, packet->data, len);
+		}
+		ast_rwlock_unlock(&tone_lock);
+	}
+	if (len) {
+		ast_atomic_fetchadd_int(&tone_hits, +1);
+		return len;
+	}
+
+	if (__atomic_load_n(seen, __ATOMIC_RELAXED) == (uint32_t) (key >> 32)) {
+		*admit = key;
+	} else {
+		__atomic_store_n(seen, (uint32_t) (key >> 32), __ATOMIC_RELAXED);
+	}
+
+	return 0;
+}
+
+static void opus_tone_put(uint64_t key, const unsigned char *data, int len)
+{
+	struct opus_tone_packet *packet = &tone_packets[key & (TONE_CACHE_SLOTS - 1)];
+
+	if (TONE_PACKET_SIZE < len) {
+		return;
+	}
+
+	ast_rwlock_wrlock(&tone_lock);
+	memcpy(packet->data, data, len);
+	packet->len = len;
+	__atomic_store_n(&packet->key, key, __ATOMIC_RELAXED);
+	ast_rwlock_unlock(&tone_lock);
+
+	ast_atomic_fetchadd_int(&tone_stored, +1);
+}
+
+/*!
+ * \brief Encode one frame, or take its packet from the tone cache
+ *
+ * \return Length of the packet, or an error of libopus
+ */
+static int opus_encode_frame(struct opus_coder_pvt *opvt, const int16_t *frame, unsigned char *dst, int size)
+{
+	uint64_t admit = 0;
+	uint64_t hash = 0;
+	int status = 0;
+
+	if (tone_cache && opus_tone_candidate(opvt, frame)) {
+		hash = opus_tone_hash(opvt, frame);
+		if (opvt->tone_previous) {
+			status = opus_tone_get(opus_tone_key(opvt, hash), dst, &admit);
+		}
+	}
+
+	if (status) {
+		opvt->tone++;
+	} else {
+		if (opvt->tone) {
+			/* the state of the encoder is from before the tone */
+			opus_encoder_ctl(opvt->opus, OPUS_RESET_STATE);
+			opvt->tone = 0;
+			admit = 0;
+		}
+		OPUS_PROBE(encode__start, opvt->id, opvt->sampling_rate, opvt->framesize);
+		/* status is either error or output bytes */
+		status = opus_encode(opvt->opus, frame, opvt->framesize, dst, size);
+		OPUS_PROBE(encode__done, opvt->id, opvt->sampling_rate, status);
+		if (admit && 0 < status) {
+			opus_tone_put(admit, dst, status);
+		}
+	}
+	if (0 <= status) {
+		opus_encoder_activity(opvt, frame);
+	}
+	opvt->tone_previous = hash;
+
+	return status;
+}
+
+/*
+ * Channels: slin is mono, unless a bridge asks for interleaved stereo, see
+ * ast_trans_pvt.interleaved_stereo. An encoder runs in stereo only when
+ * its input is stereo and both parties negotiated stereo; otherwise, it
+ * would spend bits on a copy, or on a channel nobody plays. A decoder for
+ * a mono consumer decodes in mono even when the sender sends stereo; the
+ * Opus library downmixes at nearly no cost. For the mixed cases, the input
+ * of the encoder gets converted with the helpers below.
+ */
+static int lintoopus_framein(struct ast_trans_pvt *pvt, struct ast_frame *f);
+
+/*! \brief Stereo to mono; may work in place */
+static void opus_downmix(int16_t *dst, const int16_t *src, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++) {
+		dst[i] = (src[2 * i] + src[2 * i + 1]) >> 1;
+	}
+}
+
+/*! \brief Mono to stereo; may work in place */
+static void opus_interleave(int16_t *dst, const int16_t *src, int samples)
+{
+	int i;
+
+	for (i = samples - 1; 0 <= i; i--) {
+		dst[2 * i + 1] = src[i];
+		dst[2 * i] = src[i];
+	}
+}
+
+static int opus_encoder_channels(const struct ast_trans_pvt *pvt, const struct opus_attr *attr)
+{
+	/* the G.711 translators expand into the buffer of the encoder, always mono */
+	return attr->stereo && pvt->interleaved_stereo && pvt->t->framein == lintoopus_framein ? 2 : 1;
+}
+
+static int opus_encoder_construct(struct ast_trans_pvt *pvt, int sampling_rate)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const struct opus_attr *attr = opus_encoder_attr(pvt);
+	const int channels       = opus_encoder_channels(pvt, attr);
+	struct opus_profile prof;
+	struct opus_profile settings;
+	int reused = 1;
+	int status = 0;
+
+	opvt->generation = opus_encoder_profile(&prof);
+	opus_encoder_settings(&settings, &prof, attr);
+	opvt->sampling_rate = sampling_rate;
+	opvt->multiplier = 48000 / sampling_rate;
+	opvt->channels = channels;
+	opvt->id = ast_atomic_fetchadd_int(&usage.encoder_id, 1) + 1;
+
+	if (opus_encoder_unpark(opvt, sampling_rate, channels, opus_lowdelay(&settings))) {
+		opvt->opus = opus_encoder_create(sampling_rate, channels, settings.application, &status);
+		opvt->configured = 0;
+		opvt->tone_previous = TONE_FRESH; /* a parked one has a past */
+		reused = 0;
+	}
+
+	if (status != OPUS_OK) {
+		ast_log(LOG_ERROR, "Error creating the Opus encoder: %s\n", opus_strerror(status));
+		return -1;
+	}
+
+	opus_encoder_configure(opvt, attr, &prof);
+	opvt->activity = 127 << 1; /* silence until the first frame */
+
+	ast_atomic_fetchadd_int(&usage.encoders, +1);
+	ast_atomic_fetchadd_int(&usage.encoders_at[opus_rate_index(sampling_rate)], +1);
+
+	OPUS_PROBE(encoder__new, opvt->id, sampling_rate, channels, reused);
+
+	ast_debug(3, "%s encoder #%d (%d -> opus)\n", reused ? "Reused" : "Created", opvt->id, sampling_rate);
+
+	return 0;
+}
+
+/*!
+ * \brief Follow changes of the attributes and of the profile of a running encoder
+ *
+ * Only a change in the channel count or to or from the low-delay mode
+ * requires a new encoder.
+ */
+static int opus_encoder_update(struct ast_trans_pvt *pvt)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const struct opus_attr *attr = opus_encoder_attr(pvt);
+	struct opus_profile prof = opvt->profile;
+	const int channels = opus_encoder_channels(pvt, attr);
+	struct opus_profile settings;
+	struct opus_profile current;
+	int status = 0;
+
+	if (reconfigure_running && opvt->generation != profile_generation) {
+		opvt->generation = opus_encoder_profile(&prof);
+	}
+
+	if (!memcmp(attr, &opvt->applied, sizeof(*attr)) && !memcmp(&prof, &opvt->profile, sizeof(prof))
+		&& channels == opvt->channels) {
+		return 0;
+	}
+
+	opus_encoder_settings(&settings, &prof, attr);
+	opus_encoder_settings(&current, &opvt->profile, &opvt->applied);
+	if (channels != opvt->channels || opus_lowdelay(&settings) != opus_lowdelay(&current)) {
+		OpusEncoder *opus = opus_encoder_create(opvt->sampling_rate, channels, settings.application, &status);
+
+		if (status != OPUS_OK) {
+			ast_log(LOG_ERROR, "Error creating the Opus encoder: %s\n", opus_strerror(status));
+			return -1;
+		}
+		opus_encoder_destroy(opvt->opus);
+		opvt->opus = opus;
+		/* the buffered input is in the layout of the former encoder */
+		if (channels == 1 && opvt->channels == 2) {
+			opus_downmix(opvt->buf, opvt->buf, pvt->samples);
+		} else if (channels == 2 && opvt->channels == 1) {
+			opus_interleave(opvt->buf, opvt->buf, pvt->samples);
+		}
+		opvt->channels = channels;
+		opvt->configured = 0;
+		opvt->tone = 0;
+		opvt->tone_previous = TONE_FRESH;
+		ast_debug(3, "Re-created encoder #%d\n", opvt->id);
+	}
+
+	opus_encoder_configure(opvt, attr, &prof);
+
+	return 0;
+}
+
+static int opus_decoder_construct(struct ast_trans_pvt *pvt, struct ast_frame *f)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const struct opus_attr *attr = f->subclass.format ? ast_format_get_attribute_data(f->subclass.format) : NULL;
+	int error = 0;
+
+	opvt->sampling_rate = opus_native_rate(pvt->t->dst_codec.sample_rate);
+	opvt->multiplier = 48000 / opvt->sampling_rate;
+	/* stereo only for a stereo consumer, and if negotiated; G.711 and the resampler are mono */
+	opvt->channels = attr && attr->stereo && pvt->interleaved_stereo && !opvt->companding && !opvt->resampler ? 2 : 1;
+	opvt->slot_samples = opvt->sampling_rate / 50;
+	opvt->noise_gain = 256;
+	opvt->skip_silence = skip_silence;
+
+	opvt->opus = opus_decoder_create(opvt->sampling_rate, opvt->channels, &error);
+
+	if (error != OPUS_OK) {
+		ast_log(LOG_ERROR, "Error creating the Opus decoder: %s\n", opus_strerror(error));
+		return -1;
+	}
+
+	opus_plc_init(opvt);
+
+	opvt->id = ast_atomic_fetchadd_int(&usage.decoder_id, 1) + 1;
+
+	ast_atomic_fetchadd_int(&usage.decoders, +1);
+	ast_atomic_fetchadd_int(&usage.decoders_at[opus_rate_index(opvt->sampling_rate)], +1);
+
+	OPUS_PROBE(decoder__new, opvt->id, opvt->sampling_rate);
+
+	ast_debug(3, "Created decoder #%d (opus -> %d)\n", opvt->id, opvt->sampling_rate);
+
+	return 0;
+}
+
+/*!
+ * \brief The resampler of the translators for slin32 and slin44
+ *
+ * \retval 0 when the translator does not need one, or on success
+ * \retval -1 on error
+ */
+static int opus_resampler_new(struct opus_coder_pvt *opvt, int from, int to)
+{
+	const struct opus_resample_filter *filter;
+
+	if (opus_native_rate(from) == from && opus_native_rate(to) == to) {
+		return 0;
+	}
+
+	filter = opus_resample_filter(from, to);
+	if (!filter) {
+		ast_log(LOG_ERROR, "No resampler from %d to %d\n", from, to);
+		return -1;
+	}
+
+	opvt->resampler = ast_calloc(1, sizeof(*opvt->resampler));
+	if (!opvt->resampler) {
+		return -1;
+	}
+	opvt->resampler->filter = filter;
+
+	return 0;
+}
+
+/* Translator callbacks */
+static int lintoopus_new(struct ast_trans_pvt *pvt)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const int rate = pvt->t->src_codec.sample_rate;
+
+	if (opus_resampler_new(opvt, rate, opus_native_rate(rate))) {
+		return -1;
+	}
+	if (opus_flight_new(opvt, 1)) {
+		ast_free(opvt->resampler);
+		opvt->resampler = NULL;
+		return -1;
+	}
+	if (opus_encoder_construct(pvt, opus_native_rate(rate))) {
+		/* no destroy callback after a failed newpvt */
+		opus_flight_destroy(opvt);
+		ast_free(opvt->resampler);
+		opvt->resampler = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int opustolin_new(struct ast_trans_pvt *pvt)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const int rate = pvt->t->dst_codec.sample_rate;
+
+	opvt->inited = 0; /* we do not know the "sprop" values, yet */
+	opvt->playout = ast_calloc(1, sizeof(*opvt->playout));
+	if (!opvt->playout) {
+		return -1;
+	}
+	if (opus_resampler_new(opvt, opus_native_rate(rate), rate) || opus_flight_new(opvt, 0)) {
+		ast_free(opvt->resampler);
+		opvt->resampler = NULL;
+		ast_free(opvt->playout);
+		opvt->playout = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int opustoulaw_new(struct ast_trans_pvt *pvt)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+
+	opvt->companding = COMPANDING_ULAW;
+
+	return opustolin_new(pvt);
+}
+
+static int opustoalaw_new(struct ast_trans_pvt *pvt)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+
+	opvt->companding = COMPANDING_ALAW;
+
+	return opustolin_new(pvt);
+}
+
+static int lintoopus_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const int channels = pvt->interleaved_stereo ? 2 : 1;
+	int16_t *dst = opvt->buf + pvt->samples * opvt->channels;
+
+	/* XXX We should look at how old the rest of our stream is, and if it
+	   is too old, then we should overwrite it entirely, otherwise we can
+	   get artifacts of earlier talk that do not belong */
+	if (channels == opvt->channels) {
+		memcpy(dst, f->data.ptr, f->datalen);
+	} else if (channels == 2) {
+		opus_downmix(dst, f->data.ptr, f->samples);
+	} else {
+		opus_interleave(dst, f->data.ptr, f->samples);
+	}
+	pvt->samples += f->samples;
+
+	return 0;
+}
+
+/*!
+ * \brief slin32 and slin44: resample right into the buffer of the encoder
+ */
+static int resampletoopus_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+
+	pvt->samples += opus_resample(opvt->resampler, opvt->buf + pvt->samples, f->data.ptr, f->samples,
+		pvt->interleaved_stereo ? 2 : 1);
+
+	return 0;
 }
 
-/* Translators */
-static struct ast_translator opustolin = {
-        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP,
-        .name = "opustolin",
+static int ulawtoopus_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const unsigned char *src = f->data.ptr;
+	int16_t *dst = opvt->buf + pvt->samples;
+	int i;
+
+	/* expand right into the buffer of the encoder; no slin frame between */
+	for (i = 0; i < f->samples; i++) {
+		dst[i] = AST_MULAW(src[i]);
+	}
+	pvt->samples += f->samples;
+
+	return 0;
+}
+
+static int alawtoopus_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const unsigned char *src = f->data.ptr;
+	int16_t *dst = opvt->buf + pvt->samples;
+	int i;
+
+	for (i = 0; i < f->samples; i++) {
+		dst[i] = AST_ALAW(src[i]);
+	}
+	pvt->samples += f->samples;
+
+	return 0;
+}
+
+static struct ast_frame *lintoopus_frameout(struct ast_trans_pvt *pvt)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	struct ast_frame *result = NULL;
+	struct ast_frame *last = NULL;
+	struct opus_flight_event event = { .arrival_ns = monotonic_ns(), .kind = FLIGHT_ENCODE, };
+	int samples = 0; /* output samples */
+
+	if (opus_encoder_update(pvt)) {
+		return NULL;
+	}
+
+	while (pvt->samples >= opvt->framesize) {
+		const int status = opus_encode_frame(opvt, opvt->buf + samples * opvt->channels,
+			pvt->outbuf.uc, BUFFER_SAMPLES);
+
+		samples += opvt->framesize;
+		pvt->samples -= opvt->framesize;
+
+		if (status < 0) {
+			ast_log(LOG_ERROR, "Error encoding the Opus frame: %s\n", opus_strerror(status));
+			event.kind |= FLIGHT_ERROR;
+		} else {
+			event.bytes += status;
+
+			struct ast_frame *current = ast_trans_frameout(pvt,
+				status,
+				opvt->framesize * opvt->multiplier);
+
+			if (!current) {
+				continue;
+			} else if (last) {
+				AST_LIST_NEXT(last, frame_list) = current;
+			} else {
+				result = current;
+			}
+			last = current;
+		}
+	}
+
+	/* Move the data at the end of the buffer to the front */
+	if (samples) {
+		memmove(opvt->buf, opvt->buf + samples * opvt->channels, pvt->samples * opvt->channels * sizeof(int16_t));
+
+		event.samples = samples;
+		event.ns = monotonic_ns() - event.arrival_ns;
+		opus_flight_record(opvt, &event);
+	}
+
+	return result;
+}
+
+static int opustolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	struct opus_flight_event event = { .arrival_ns = monotonic_ns(), .seqno = f->seqno, .bytes = f->datalen, };
+	const struct opus_decode_stats before = opvt->stats;
+	const int samples = pvt->samples;
+	int status;
+
+	if (!opvt->inited && f->datalen == 0) {
+		return 0; /* we cannot start without data */
+	} else if (!opvt->inited) { /* 0 < f->datalen */
+		status = opus_decoder_construct(pvt, f);
+		opvt->inited = 1;
+		if (status) {
+			return status;
+		}
+	}
+
+	/*
+	 * When we get a frame indicator (ast_null_frame), format is NULL. Because FEC
+	 * status can change any time (SDP re-negotiation), we save again and again.
+	 */
+	if (f->subclass.format) {
+		struct opus_attr *attr = ast_format_get_attribute_data(f->subclass.format);
+
+		if (attr) {
+			opvt->decode_fec_incoming = attr->fec;
+		}
+	}
+
+	opvt->timing = ast_test_flag(f, AST_FRFLAG_HAS_TIMING_INFO);
+	opvt->ts = f->ts;
+
+	OPUS_PROBE(decode__start, opvt->id, opvt->sampling_rate, f->seqno, f->datalen);
+	status = opus_decode_frame(pvt, f);
+	OPUS_PROBE(decode__done, opvt->id, opvt->sampling_rate, f->seqno, pvt->samples);
+
+	event.ns = monotonic_ns() - event.arrival_ns;
+	event.samples = pvt->samples - samples;
+	event.kind = (opvt->stats.decoded != before.decoded ? FLIGHT_DECODE : 0)
+		| (opvt->stats.recovered != before.recovered ? FLIGHT_FEC : 0)
+		| (opvt->stats.concealed != before.concealed ? FLIGHT_PLC : 0)
+		| (opvt->stats.noise != before.noise ? FLIGHT_NOISE : 0)
+		| (status ? FLIGHT_ERROR : 0);
+	opus_flight_record(opvt, &event);
+
+	return status;
+}
+
+/*!
+ * \brief Hand out the decoded audio in frames of decoder_frame_ms
+ *
+ * Otherwise, a packet of 40 ms or more, or a burst of concealed slots, would
+ * leave as one large frame. The remainder leaves right away as a shorter
+ * frame, because holding it back would add delay. The core sets the timing
+ * of the first frame; the others follow it.
+ */
+static struct ast_frame *opustolin_frameout(struct ast_trans_pvt *pvt)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const int rate = pvt->t->dst_codec.sample_rate; /* of the output, see opus_resample.h */
+	const int frame_ms = decoder_frame_ms;
+	const int frame_samples = rate * frame_ms / 1000;
+	char *const outbuf = pvt->outbuf.c;
+	struct ast_frame *result = NULL;
+	struct ast_frame *last = NULL;
+	long offset = 0; /* ms */
+	int consumed = 0; /* bytes */
+
+	if (!frame_ms || pvt->samples <= frame_samples) {
+		return ast_trans_frameout(pvt, 0, 0);
+	}
+
+	while (pvt->samples) {
+		const int samples = MIN(pvt->samples, frame_samples);
+		const int datalen = opvt->companding ? samples : samples * opvt->channels * sizeof(int16_t);
+		struct ast_frame *current;
+
+		/* ast_trans_frameout() takes the data from the front of the buffer */
+		pvt->outbuf.c = outbuf + consumed;
+		current = ast_trans_frameout(pvt, datalen, samples);
+		pvt->outbuf.c = outbuf;
+		consumed += datalen;
+		pvt->samples -= samples;
+		pvt->datalen -= datalen;
+
+		if (!current) {
+			continue;
+		} else if (last) {
+			if (opvt->timing) {
+				ast_set_flag(current, AST_FRFLAG_HAS_TIMING_INFO);
+				current->ts = opvt->ts + offset;
+				current->len = samples * 1000 / rate;
+			}
+			AST_LIST_NEXT(last, frame_list) = current;
+		} else {
+			result = current;
+		}
+		offset += samples * 1000 / rate;
+		last = current;
+	}
+
+	return result;
+}
+
+static void lintoopus_destroy(struct ast_trans_pvt *arg)
+{
+	struct opus_coder_pvt *opvt = arg->pvt;
+
+	if (!opvt) {
+		return;
+	}
+
+	opus_flight_destroy(opvt);
+	ast_free(opvt->resampler);
+	opvt->resampler = NULL;
+
+	if (!opvt->opus) {
+		return;
+	}
+
+	if (opus_encoder_park(opvt)) {
+		opus_encoder_destroy(opvt->opus);
+		OPUS_PROBE(encoder__destroy, opvt->id, opvt->sampling_rate, 0);
+	} else {
+		OPUS_PROBE(encoder__destroy, opvt->id, opvt->sampling_rate, 1);
+	}
+	opvt->opus = NULL;
+
+	ast_atomic_fetchadd_int(&usage.encoders, -1);
+	ast_atomic_fetchadd_int(&usage.encoders_at[opus_rate_index(opvt->sampling_rate)], -1);
+
+	ast_debug(3, "Destroyed encoder #%d (%d->opus)\n", opvt->id, opvt->sampling_rate);
+}
+
+int ast_opus_get_activity(const struct ast_trans_pvt *path, struct ast_opus_activity *activity)
+{
+	const struct opus_coder_pvt *opvt;
+	int value;
+
+	/* the lock of the channel, held by the caller, keeps the path alive */
+
+	while (path && path->next) {
+		path = path->next;
+	}
+	if (!path || !path->t || path->t->destroy != lintoopus_destroy) {
+		return -1;
+	}
+
+	opvt = path->pvt;
+	value = __atomic_load_n(&opvt->activity, __ATOMIC_RELAXED);
+	activity->active = value & 1;
+	activity->level = value >> 1;
+
+	return 0;
+}
+
+static void opustolin_destroy(struct ast_trans_pvt *arg)
+{
+	struct opus_coder_pvt *opvt = arg->pvt;
+
+	if (!opvt) {
+		return;
+	}
+
+	if (opvt->playout && (opvt->playout->late || opvt->playout->reordered)) {
+		ast_debug(3, "Decoder #%d: %u late packet(s), %u reordered\n",
+			opvt->id, opvt->playout->late, opvt->playout->reordered);
+	}
+	ast_debug(3, "Decoder #%d: %u slot(s) decoded, %u via FEC, %u via PLC, %u comfort noise, %u skipped\n",
+		opvt->id, opvt->stats.decoded, opvt->stats.recovered, opvt->stats.concealed, opvt->stats.noise,
+		opvt->stats.skipped);
+	ast_free(opvt->playout);
+	opvt->playout = NULL;
+	ast_free(opvt->resampler);
+	opvt->resampler = NULL;
+	opus_flight_destroy(opvt);
+
+	if (!opvt->opus) {
+		return;
+	}
+
+	opus_decoder_destroy(opvt->opus);
+	opvt->opus = NULL;
+
+	OPUS_PROBE(decoder__destroy, opvt->id, opvt->sampling_rate,
+		opvt->stats.decoded, opvt->stats.recovered, opvt->stats.concealed, opvt->stats.noise);
+
+	ast_atomic_fetchadd_int(&usage.decoders, -1);
+	ast_atomic_fetchadd_int(&usage.decoders_at[opus_rate_index(opvt->sampling_rate)], -1);
+
+	ast_debug(3, "Destroyed decoder #%d (opus->%d)\n", opvt->id, opvt->sampling_rate);
+}
+
+int ast_opus_get_decoder_activity(const struct ast_trans_pvt *path)
+{
+	const struct opus_coder_pvt *opvt;
+
+	/* the lock of the channel, held by the caller, keeps the path alive */
+
+	if (!path || !path->t || path->t->destroy != opustolin_destroy) {
+		return -1;
+	}
+
+	opvt = path->pvt;
+
+	return !opvt->silent;
+}
+
+/*
+ * Multitrack recording into one Ogg Opus file: each track, for example a
+ * participant of a conference, becomes a stream with channel mapping family
+ * 255 (RFC 7845), as many channels as tracks, each a mono stream of its own.
+ * Opus packets of 20 ms go into the file as they are. Other Opus packets
+ * get decoded, and slin gets encoded, by an encoder of the track which needs
+ * one. All tracks share the file, and whole pages leave through one
+ * buffered stream.
+ */
+#define	RECORDER_FRAME	960	/* 20 ms at 48 kHz, the duration of a slot */
+#define	RECORDER_QUEUE	16	/* packets per track, power of two */
+#define	RECORDER_LAG	5	/* slots a track may lead before missing ones get DTX */
+#define	RECORDER_PACKET_SIZE	1500	/* RTP packets do not get larger */
+#define	RECORDER_STREAM_SIZE	(RECORDER_PACKET_SIZE + 2 + 2 * 48)	/* self-delimited */
+#define	RECORDER_PAGE_PACKETS	50	/* a page per second */
+#define	RECORDER_PRE_SKIP	312	/* lookahead of the encoder of libopus */
+#define	RECORDER_MAX_TRACKS	255
+#define	RECORDER_BUFFER	65536	/* of the stream, for batching the page writes */
+#define	OGG_MAX_BODY	(255 * 255)
+
+struct opus_recorder_track {
+	OpusEncoder *encoder;	/* for slin */
+	OpusDecoder *decoder;	/* for Opus packets not of 20 ms */
+	int rate;		/* of the encoder */
+	int pcm_samples;
+	int16_t pcm[RECORDER_FRAME];	/* less than one frame of slin */
+	unsigned int head;	/* packets queued */
+	unsigned int tail;	/* packets written */
+	int len[RECORDER_QUEUE];
+	unsigned char packet[RECORDER_QUEUE][RECORDER_PACKET_SIZE];
+};
+
+struct ast_opus_recorder {
+	ast_mutex_t lock;
+	FILE *file;
+	int failed;
+	unsigned int serial;
+	unsigned int sequence;	/* of the next page */
+	long long granule;	/* after the last packet */
+	long long page_granule;	/* -1 while no packet ends on the page */
+	int page_packets;
+	int continued;		/* the page starts with the rest of a packet */
+	int segments;
+	int body_len;
+	unsigned char lacing[255];
+	unsigned char body[OGG_MAX_BODY];
+	unsigned char *packet;	/* the multistream packet of a slot */
+	int tracks;
+	struct opus_recorder_track track[];
+};
+
+/* A packet without frame data, for a track without a packet in a slot */
+static const unsigned char opus_recorder_dtx[] = { 1 << 3 }; /* SILK NB, 20 ms */
+
+static uint32_t ogg_crc_table[256];
+
+static void ogg_crc_init(void)
+{
+	uint32_t r;
+	int i;
+	int j;
+
+	/* polynomial 0x04c11db7, not reflected, unlike the one of zlib */
+	for (i = 0; i < 256; i++) {
+		r = (uint32_t) i << 24;
+		for (j = 0; j < 8; j++) {
+			r = r & 0x80000000 ? (r << 1) ^ 0x04c11db7 : r << 1;
+		}
+		ogg_crc_table[i] = r;
+	}
+}
+
+static uint32_t ogg_crc(uint32_t crc, const unsigned char *data, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++) {
+		crc = (crc << 8) ^ ogg_crc_table[(crc >> 24) ^ data[i]];
+	}
+
+	return crc;
+}
+
+static void put_le(unsigned char *dst, unsigned long long value, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++) {
+		dst[i] = value >> (8 * i);
+	}
+}
+
+/*! \brief Write the current page; flags 2 for the first, 4 for the last */
+static void opus_recorder_page(struct ast_opus_recorder *r, int flags)
+{
+	unsigned char header[27 + 255];
+	const int header_len = 27 + r->segments;
+
+	memcpy(header, "OggS", 4);
+	header[4] = 0; /* version */
+	header[5] = flags | r->continued;
+	put_le(header + 6, r->page_granule, 8);
+	put_le(header + 14, r->serial, 4);
+	put_le(header + 18, r->sequence++, 4);
+	put_le(header + 22, 0, 4);
+	header[26] = r->segments;
+	memcpy(header + 27, r->lacing, r->segments);
+	put_le(header + 22, ogg_crc(ogg_crc(0, header, header_len), r->body, r->body_len), 4);
+
+	if (!r->failed && (fwrite(header, 1, header_len, r->file) != (size_t) header_len
+		|| fwrite(r->body, 1, r->body_len, r->file) != (size_t) r->body_len)) {
+		ast_log(LOG_ERROR, "Error writing the Opus recording: %s\n", strerror(errno));
+		r->failed = 1;
+	}
+
+	r->segments = 0;
+	r->body_len = 0;
+	r->page_packets = 0;
+	r->page_granule = -1;
+	r->continued = 0;
+}
+
+/*! \brief Add a packet, which may continue on further pages */
+static void opus_recorder_packet(struct ast_opus_recorder *r, const unsigned char *data, int len)
+{
+	int started = 0;
+	int lacing;
+
+	do {
+		if (r->segments == 255) {
+			opus_recorder_page(r, 0);
+			r->continued = started;
+		}
+		started = 1;
+		lacing = MIN(len, 255);
+		r->lacing[r->segments++] = lacing;
+		memcpy(r->body + r->body_len, data, lacing);
+		r->body_len += lacing;
+		data += lacing;
+		len -= lacing;
+	} while (lacing == 255); /* a packet of a multiple of 255 ends with a 0 */
+
+	r->page_granule = r->granule;
+	r->page_packets++;
+}
+
+static int opus_frame_length(unsigned char *dst, int len)
+{
+	if (len < 252) {
+		dst[0] = len;
+		return 1;
+	}
+	dst[0] = 252 + (len & 3);
+	dst[1] = (len - dst[0]) >> 2;
+
+	return 2;
+}
+
+/*!
+ * \brief Append the packet of a track to the multistream packet
+ *
+ * All streams but the last one are self-delimited (RFC 6716, appendix B):
+ * the length of the last frame gets coded as well. Such a stream is re-coded
+ * as code 0 with one frame, or as code 3 with variable frame sizes.
+ *
+ * \return Bytes appended, or -1 for an invalid packet
+ */
+static int opus_recorder_append(unsigned char *dst, const unsigned char *src, int len, int self_delimited)
+{
+	const unsigned char *frames[48];
+	opus_int16 sizes[48];
+	unsigned char toc;
+	int count;
+	int pos = 0;
+	int i;
+
+	count = opus_packet_parse(src, len, &toc, frames, sizes, NULL);
+	if (count <= 0) {
+		return -1;
+	}
+	if (!self_delimited) {
+		memcpy(dst, src, len);
+		return len;
+	}
+
+	if (count == 1) {
+		dst[pos++] = toc & 0xfc;
+	} else {
+		dst[pos++] = toc | 3;
+		dst[pos++] = 0x80 | count;
+	}
+	for (i = 0; i < count; i++) {
+		pos += opus_frame_length(dst + pos, sizes[i]);
+	}
+	for (i = 0; i < count; i++) {
+		memcpy(dst + pos, frames[i], sizes[i]);
+		pos += sizes[i];
+	}
+
+	return pos;
+}
+
+/*! \brief Write one slot, with the next packet of each track */
+static void opus_recorder_slot(struct ast_opus_recorder *r)
+{
+	int pos = 0;
+	int i;
+
+	for (i = 0; i < r->tracks; i++) {
+		struct opus_recorder_track *t = &r->track[i];
+		const int self_delimited = i < r->tracks - 1;
+		int len = -1;
+
+		if (t->head != t->tail) {
+			const int slot = t->tail++ % RECORDER_QUEUE;
+
+			len = opus_recorder_append(r->packet + pos, t->packet[slot], t->len[slot], self_delimited);
+		}
+		if (len < 0) {
+			len = opus_recorder_append(r->packet + pos, opus_recorder_dtx, sizeof(opus_recorder_dtx), self_delimited);
+		}
+		pos += len;
+	}
+
+	r->granule += RECORDER_FRAME;
+	opus_recorder_packet(r, r->packet, pos);
+	if (RECORDER_PAGE_PACKETS <= r->page_packets) {
+		opus_recorder_page(r, 0);
+	}
+}
+
+/*!
+ * \brief Write the slots which are complete
+ *
+ * A slot is complete when each track has a packet for it, or when a track
+ * is RECORDER_LAG slots ahead; the tracks behind get DTX for it then.
+ */
+static void opus_recorder_flush(struct ast_opus_recorder *r, int all)
+{
+	for (;;) {
+		int complete = 1;
+		int pending = 0;
+		int i;
+
+		for (i = 0; i < r->tracks; i++) {
+			const unsigned int queued = r->track[i].head - r->track[i].tail;
+
+			complete &= 0 < queued;
+			pending |= 0 < queued;
+			if (RECORDER_LAG <= queued) {
+				complete = 1;
+				break;
+			}
+		}
+		if (!complete && !(all && pending)) {
+			return;
+		}
+		opus_recorder_slot(r);
+	}
+}
+
+/*! \brief The next free packet of a track; the oldest one gets lost, if none */
+static unsigned char *opus_recorder_reserve(struct opus_recorder_track *t)
+{
+	if (t->head - t->tail == RECORDER_QUEUE) {
+		t->tail++;
+	}
+
+	return t->packet[t->head % RECORDER_QUEUE];
+}
+
+static void opus_recorder_commit(struct opus_recorder_track *t, int len)
+{
+	t->len[t->head++ % RECORDER_QUEUE] = len;
+}
+
+/*! \brief Encode slin in frames of 20 ms */
+static int opus_recorder_pcm(struct opus_recorder_track *t, const int16_t *pcm, int samples, int rate)
+{
+	const int frame = rate / 50;
+	int status;
+
+	if (rate != 8000 && rate != 12000 && rate != 16000 && rate != 24000 && rate != 48000) {
+		return -1;
+	}
+	if (t->encoder && t->rate != rate) {
+		opus_encoder_destroy(t->encoder);
+		t->encoder = NULL;
+	}
+	if (!t->encoder) {
+		t->encoder = opus_encoder_create(rate, 1, OPUS_APPLICATION_VOIP, &status);
+		if (status != OPUS_OK) {
+			ast_log(LOG_ERROR, "Error creating the Opus encoder: %s\n", opus_strerror(status));
+			t->encoder = NULL;
+			return -1;
+		}
+		t->rate = rate;
+		t->pcm_samples = 0;
+	}
+
+	while (samples) {
+		const int chunk = MIN(samples, frame - t->pcm_samples);
+
+		memcpy(t->pcm + t->pcm_samples, pcm, chunk * sizeof(*pcm));
+		t->pcm_samples += chunk;
+		pcm += chunk;
+		samples -= chunk;
+
+		if (t->pcm_samples == frame) {
+			status = opus_encode(t->encoder, t->pcm, frame, opus_recorder_reserve(t), RECORDER_PACKET_SIZE);
+			if (0 < status) {
+				opus_recorder_commit(t, status);
+			}
+			t->pcm_samples = 0;
+		}
+	}
+
+	return 0;
+}
+
+/*! \brief Decode an Opus packet not of 20 ms, to encode it again */
+static int opus_recorder_transcode(struct opus_recorder_track *t, const unsigned char *data, int len)
+{
+	int16_t pcm[5760];
+	int status;
+
+	if (!t->decoder) {
+		t->decoder = opus_decoder_create(48000, 1, &status);
+		if (status != OPUS_OK) {
+			ast_log(LOG_ERROR, "Error creating the Opus decoder: %s\n", opus_strerror(status));
+			t->decoder = NULL;
+			return -1;
+		}
+	}
+
+	status = opus_decode(t->decoder, data, len, pcm, ARRAY_LEN(pcm), 0);
+	if (status < 0) {
+		return -1;
+	}
+
+	return opus_recorder_pcm(t, pcm, status, 48000);
+}
+
+static void opus_recorder_headers(struct ast_opus_recorder *r, const char * const *names)
+{
+	const char *vendor = opus_get_version_string();
+	const int vendor_len = strlen(vendor);
+	unsigned char *head = r->packet;
+	int comments = 0;
+	int pos;
+	int i;
+
+	/* OpusHead, RFC 7845 section 5.1 */
+	memcpy(head, "OpusHead", 8);
+	head[8] = 1;
+	head[9] = r->tracks;
+	put_le(head + 10, RECORDER_PRE_SKIP, 2);
+	put_le(head + 12, 48000, 4);
+	put_le(head + 16, 0, 2);
+	head[18] = 255; /* independent streams */
+	head[19] = r->tracks;
+	head[20] = 0; /* none coupled */
+	for (i = 0; i < r->tracks; i++) {
+		head[21 + i] = i;
+	}
+	opus_recorder_packet(r, head, 21 + r->tracks);
+	r->page_granule = 0;
+	opus_recorder_page(r, 2);
+
+	/* OpusTags, with the names of the tracks as TRACK<n>= */
+	memcpy(head, "OpusTags", 8);
+	put_le(head + 8, vendor_len, 4);
+	memcpy(head + 12, vendor, vendor_len);
+	pos = 12 + vendor_len + 4; /* after the count of the comments */
+	for (i = 0; names && i < r->tracks; i++) {
+		char comment[96];
+		const int len = names[i] ? snprintf(comment, sizeof(comment), "TRACK%d=%s", i, names[i]) : 0;
+
+		if (0 < len && len < (int) sizeof(comment)) {
+			put_le(head + pos, len, 4);
+			memcpy(head + pos + 4, comment, len);
+			pos += 4 + len;
+			comments++;
+		}
+	}
+	put_le(head + 12 + vendor_len, comments, 4);
+	opus_recorder_packet(r, head, pos);
+	r->page_granule = 0;
+	opus_recorder_page(r, 0);
+}
+
+struct ast_opus_recorder *ast_opus_recorder_create(const char *filename, int tracks, const char * const *names)
+{
+	struct ast_opus_recorder *r;
+
+	if (tracks < 1 || RECORDER_MAX_TRACKS < tracks) {
+		ast_log(LOG_ERROR, "An Opus recording takes 1 to %d tracks, not %d\n", RECORDER_MAX_TRACKS, tracks);
+		return NULL;
+	}
+
+	r = ast_calloc(1, sizeof(*r) + tracks * sizeof(r->track[0]));
+	if (!r) {
+		return NULL;
+	}
+	r->tracks = tracks;
+	/* the multistream packet, or the OpusTags */
+	r->packet = ast_malloc(MAX(tracks * RECORDER_STREAM_SIZE,
+		12 + strlen(opus_get_version_string()) + 4 + tracks * (4 + 96)));
+	r->file = fopen(filename, "wb");
+	if (!r->packet || !r->file) {
+		ast_log(LOG_ERROR, "Error creating the Opus recording %s: %s\n", filename, strerror(errno));
+		if (r->file) {
+			fclose(r->file);
+		}
+		ast_free(r->packet);
+		ast_free(r);
+		return NULL;
+	}
+	setvbuf(r->file, NULL, _IOFBF, RECORDER_BUFFER);
+	ast_mutex_init(&r->lock);
+	r->serial = ast_random();
+	r->page_granule = -1;
+
+	opus_recorder_headers(r, names);
+
+	return r;
+}
+
+int ast_opus_recorder_write(struct ast_opus_recorder *r, int track, struct ast_frame *f)
+{
+	struct opus_recorder_track *t;
+	int res = 0;
+
+	if (track < 0 || r->tracks <= track || f->frametype != AST_FRAME_VOICE) {
+		return -1;
+	} else if (!f->datalen) {
+		return 0;
+	}
+	t = &r->track[track];
+
+	ast_mutex_lock(&r->lock);
+	if (ast_format_cmp(f->subclass.format, ast_format_opus) == AST_FORMAT_CMP_EQUAL) {
+		if (opus_packet_get_nb_samples(f->data.ptr, f->datalen, 48000) == RECORDER_FRAME
+			&& f->datalen <= RECORDER_PACKET_SIZE) {
+			memcpy(opus_recorder_reserve(t), f->data.ptr, f->datalen); /* as it is */
+			opus_recorder_commit(t, f->datalen);
+		} else {
+			res = opus_recorder_transcode(t, f->data.ptr, f->datalen);
+		}
+	} else if (ast_format_cache_is_slinear(f->subclass.format)) {
+		res = opus_recorder_pcm(t, f->data.ptr, f->samples, ast_format_get_sample_rate(f->subclass.format));
+	} else {
+		res = -1;
+	}
+	opus_recorder_flush(r, 0);
+	ast_mutex_unlock(&r->lock);
+
+	return res;
+}
+
+void ast_opus_recorder_destroy(struct ast_opus_recorder *r)
+{
+	int i;
+
+	if (!r) {
+		return;
+	}
+
+	opus_recorder_flush(r, 1);
+	r->page_granule = r->granule;
+	opus_recorder_page(r, 4);
+	if (fclose(r->file) && !r->failed) {
+		ast_log(LOG_ERROR, "Error writing the Opus recording: %s\n", strerror(errno));
+	}
+
+	for (i = 0; i < r->tracks; i++) {
+		if (r->track[i].encoder) {
+			opus_encoder_destroy(r->track[i].encoder);
+		}
+		if (r->track[i].decoder) {
+			opus_decoder_destroy(r->track[i].decoder);
+		}
+	}
+	ast_mutex_destroy(&r->lock);
+	ast_free(r->packet);
+	ast_free(r);
+}
+
+/*
+ * OPUS_RECORD(<file>[,<tracks>]): records what the channel sends into the
+ * next free track of <file>, for example each participant of a ConfBridge.
+ * The first channel creates the file with <tracks> tracks, default 8, and
+ * the last one to hang up finishes it. A framehook sees the frames before
+ * the translation to the read format, so Opus goes in as it arrives.
+ */
+#define	RECORD_TRACKS	8
+
+struct opus_recording {
+	AST_LIST_ENTRY(opus_recording) list;
+	struct ast_opus_recorder *recorder;
+	int tracks;
+	int next_track;
+	int users;
+	char filename[0];
+};
+
+static AST_LIST_HEAD_NOLOCK_STATIC(recordings, opus_recording);
+AST_MUTEX_DEFINE_STATIC(recordings_lock);
+
+struct opus_record_hook {
+	struct opus_recording *recording;
+	int track;
+};
+
+/*! \brief Find or start the recording of a file, and take its next track */
+static struct opus_recording *opus_recording_join(const char *filename, int tracks, const char *name, int *track)
+{
+	struct opus_recording *recording;
+
+	ast_mutex_lock(&recordings_lock);
+	AST_LIST_TRAVERSE(&recordings, recording, list) {
+		if (!strcmp(recording->filename, filename)) {
+			break;
+		}
+	}
+	if (!recording) {
+		const char *names[RECORDER_MAX_TRACKS] = { name, };
+
+		recording = ast_calloc(1, sizeof(*recording) + strlen(filename) + 1);
+		if (recording) {
+			/* the names go into the header, which only the first one knows */
+			recording->recorder = ast_opus_recorder_create(filename, tracks, names);
+			if (!recording->recorder) {
+				ast_free(recording);
+				recording = NULL;
+			}
+		}
+		if (recording) {
+			strcpy(recording->filename, filename); /* safe */
+			recording->tracks = tracks;
+			AST_LIST_INSERT_TAIL(&recordings, recording, list);
+		}
+	} else if (recording->tracks <= recording->next_track) {
+		ast_log(LOG_WARNING, "All %d tracks of the Opus recording %s are taken\n", recording->tracks, filename);
+		recording = NULL;
+	}
+	if (recording) {
+		*track = recording->next_track++;
+		recording->users++;
+	}
+	ast_mutex_unlock(&recordings_lock);
+
+	return recording;
+}
+
+static void opus_recording_leave(struct opus_recording *recording)
+{
+	int last;
+
+	ast_mutex_lock(&recordings_lock);
+	last = !--recording->users;
+	if (last) {
+		AST_LIST_REMOVE(&recordings, recording, list);
+	}
+	ast_mutex_unlock(&recordings_lock);
+
+	if (last) {
+		ast_opus_recorder_destroy(recording->recorder);
+		ast_free(recording);
+	}
+}
+
+static struct ast_frame *opus_record_event(struct ast_channel *chan, struct ast_frame *frame,
+	enum ast_framehook_event event, void *data)
+{
+	struct opus_record_hook *hook = data;
+
+	if (frame && event == AST_FRAMEHOOK_EVENT_READ && frame->frametype == AST_FRAME_VOICE) {
+		ast_opus_recorder_write(hook->recording->recorder, hook->track, frame);
+	}
+
+	return frame;
+}
+
+static void opus_record_destroy(void *data)
+{
+	struct opus_record_hook *hook = data;
+
+	opus_recording_leave(hook->recording);
+	ast_free(hook);
+	ast_module_unref(ast_module_info->self);
+}
+
+static int opus_record_write(struct ast_channel *chan, const char *cmd, char *data, const char *value)
+{
+	struct ast_framehook_interface interface = {
+		.version = AST_FRAMEHOOK_INTERFACE_VERSION,
+		.event_cb = opus_record_event,
+		.destroy_cb = opus_record_destroy,
+	};
+	struct opus_record_hook *hook;
+	int tracks = RECORD_TRACKS;
+	int id;
+	AST_DECLARE_APP_ARGS(args,
+		AST_APP_ARG(filename);
+		AST_APP_ARG(tracks);
+	);
+
+	if (!chan) {
+		return -1;
+	}
+	AST_STANDARD_APP_ARGS(args, data);
+	if (ast_strlen_zero(args.filename)
+		|| (!ast_strlen_zero(args.tracks) && (sscanf(args.tracks, "%30d", &tracks) != 1
+			|| tracks < 1 || RECORDER_MAX_TRACKS < tracks))) {
+		ast_log(LOG_WARNING, "Usage: %s(<file>[,<tracks>])=<name of the track>\n", cmd);
+		return -1;
+	}
+
+	hook = ast_calloc(1, sizeof(*hook));
+	if (!hook) {
+		return -1;
+	}
+	hook->recording = opus_recording_join(args.filename, tracks,
+		S_OR(value, ast_channel_name(chan)), &hook->track);
+	if (!hook->recording) {
+		ast_free(hook);
+		return -1;
+	}
+	interface.data = hook;
+
+	ast_module_ref(ast_module_info->self);
+	ast_channel_lock(chan);
+	id = ast_framehook_attach(chan, &interface);
+	ast_channel_unlock(chan);
+	if (id < 0) {
+		opus_record_destroy(hook);
+		return -1;
+	}
+	ast_verb(3, "Recording %s as track %d of %s\n", ast_channel_name(chan), hook->track, args.filename);
+
+	return 0;
+}
+
+static struct ast_custom_function opus_record_function = {
+	.name = "OPUS_RECORD",
+	.write = opus_record_write,
+};
+
+static char *handle_cli_opus_show(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct codec_usage copy;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "opus show";
+		e->usage =
+			"Usage: opus show\n"
+			"       Displays Opus encoder/decoder utilization.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 2) {
+		return CLI_SHOWUSAGE;
+	}
+
+	copy = usage;
+
+	ast_cli(a->fd, "%d/%d encoders/decoders are in use.\n", copy.encoders, copy.decoders);
+	if (tone_cache) {
+		ast_cli(a->fd, "Tone cache: %d packets stored, %d frames not encoded.\n", tone_stored, tone_hits);
+	}
+	ast_cli(a->fd, "%d translators registered; the module took %ld ms to load.\n", load_registered, load_ms);
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_cli_opus_show_flight(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct opus_flight_event events[FLIGHT_EVENTS];
+	struct opus_flight *flight;
+	char line[128];
+	int sampling_rate = 0;
+	int encoder;
+	int count = 0;
+	int id;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "opus show flight {encoder|decoder}";
+		e->usage =
+			"Usage: opus show flight {encoder|decoder} <id>\n"
+			"       Displays the last frames of an Opus encoder/decoder,\n"
+			"       with their arrival relative to the last one, the time\n"
+			"       spent in the translator, and how they were handled.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 5 || sscanf(a->argv[4], "%30d", &id) != 1) {
+		return CLI_SHOWUSAGE;
+	}
+	encoder = !strcasecmp(a->argv[3], "encoder");
+
+	AST_LIST_LOCK(&flights);
+	AST_LIST_TRAVERSE(&flights, flight, list) {
+		if (flight->encoder == encoder && flight->opvt->id == id) {
+			sampling_rate = flight->opvt->sampling_rate;
+			count = opus_flight_copy(flight, events);
+			break;
+		}
+	}
+	AST_LIST_UNLOCK(&flights);
+
+	if (!flight) {
+		ast_cli(a->fd, "No %s #%d in use.\n", a->argv[3], id);
+		return CLI_FAILURE;
+	}
+
+	ast_cli(a->fd, "%s #%d (%d Hz): last %d frames\n", encoder ? "Encoder" : "Decoder", id, sampling_rate, count);
+	for (i = 0; i < count; i++) { /* relative to the last frame */
+		opus_flight_format(&events[i], events[count - 1].arrival_ns, line, sizeof(line));
+		ast_cli(a->fd, "%s\n", line);
+	}
+
+	return CLI_SUCCESS;
+}
+
+/* Translators */
+static struct ast_translator opustolin = {
+        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP,
+        .name = "opustolin",
+        .src_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .dst_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 8000,
+        },
+        .format = "slin",
+        .newpvt = opustolin_new,
+        .framein = opustolin_framein,
+        .frameout = opustolin_frameout,
+        .destroy = opustolin_destroy,
+        .sample = opus_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = (BUFFER_SAMPLES / (48000 / 8000)) * 2, /* because of possible FEC */
+        .buf_size = (BUFFER_SAMPLES / (48000 / 8000)) * MAX_CHANNELS * sizeof(opus_int16) * 2,
+        .native_plc = 1,
+};
+
+static struct ast_translator lintoopus = {
+        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP,
+        .name = "lintoopus",
+        .src_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 8000,
+        },
+        .dst_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .format = "opus",
+        .newpvt = lintoopus_new,
+        .framein = lintoopus_framein,
+        .frameout = lintoopus_frameout,
+        .destroy = lintoopus_destroy,
+        .sample = slin8_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES,
+        .buf_size = BUFFER_SAMPLES * 2,
+};
+
+static struct ast_translator opustolin12 = {
+        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP - 1,
+        .name = "opustolin12",
+        .src_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .dst_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 12000,
+        },
+        .format = "slin12",
+        .newpvt = opustolin_new,
+        .framein = opustolin_framein,
+        .frameout = opustolin_frameout,
+        .destroy = opustolin_destroy,
+        .sample = opus_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = (BUFFER_SAMPLES / (48000 / 12000)) * 2, /* because of possible FEC */
+        .buf_size = (BUFFER_SAMPLES / (48000 / 12000)) * MAX_CHANNELS * sizeof(opus_int16) * 2,
+        .native_plc = 1,
+};
+
+static struct ast_translator lin12toopus = {
+        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP - 1,
+        .name = "lin12toopus",
+        .src_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 12000,
+        },
+        .dst_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .format = "opus",
+        .newpvt = lintoopus_new,
+        .framein = lintoopus_framein,
+        .frameout = lintoopus_frameout,
+        .destroy = lintoopus_destroy,
+        .sample = slin12_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES,
+        .buf_size = BUFFER_SAMPLES * 2,
+};
+
+static struct ast_translator opustolin16 = {
+        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP - 2,
+        .name = "opustolin16",
+        .src_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .dst_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 16000,
+        },
+        .format = "slin16",
+        .newpvt = opustolin_new,
+        .framein = opustolin_framein,
+        .frameout = opustolin_frameout,
+        .destroy = opustolin_destroy,
+        .sample = opus_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = (BUFFER_SAMPLES / (48000 / 16000)) * 2, /* because of possible FEC */
+        .buf_size = (BUFFER_SAMPLES / (48000 / 16000)) * MAX_CHANNELS * sizeof(opus_int16) * 2,
+        .native_plc = 1,
+};
+
+static struct ast_translator lin16toopus = {
+        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP - 2,
+        .name = "lin16toopus",
+        .src_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 16000,
+        },
+        .dst_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .format = "opus",
+        .newpvt = lintoopus_new,
+        .framein = lintoopus_framein,
+        .frameout = lintoopus_frameout,
+        .destroy = lintoopus_destroy,
+        .sample = slin16_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES,
+        .buf_size = BUFFER_SAMPLES * 2,
+};
+
+static struct ast_translator opustolin24 = {
+        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP - 4,
+        .name = "opustolin24",
+        .src_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .dst_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 24000,
+        },
+        .format = "slin24",
+        .newpvt = opustolin_new,
+        .framein = opustolin_framein,
+        .frameout = opustolin_frameout,
+        .destroy = opustolin_destroy,
+        .sample = opus_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = (BUFFER_SAMPLES / (48000 / 24000)) * 2, /* because of possible FEC */
+        .buf_size = (BUFFER_SAMPLES / (48000 / 24000)) * MAX_CHANNELS * sizeof(opus_int16) * 2,
+        .native_plc = 1,
+};
+
+static struct ast_translator lin24toopus = {
+        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP - 4,
+        .name = "lin24toopus",
+        .src_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 24000,
+        },
+        .dst_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .format = "opus",
+        .newpvt = lintoopus_new,
+        .framein = lintoopus_framein,
+        .frameout = lintoopus_frameout,
+        .destroy = lintoopus_destroy,
+        .sample = slin24_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES,
+        .buf_size = BUFFER_SAMPLES * 2,
+};
+
+static struct ast_translator opustolin32 = {
+        .table_cost = AST_TRANS_COST_LY_LL_DOWNSAMP,
+        .name = "opustolin32",
+        .src_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .dst_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 32000,
+        },
+        .format = "slin32",
+        .newpvt = opustolin_new,
+        .framein = opustolin_framein,
+        .frameout = opustolin_frameout,
+        .destroy = opustolin_destroy,
+        .sample = opus_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES * 2, /* twice, because of possible FEC */
+        .buf_size = BUFFER_SAMPLES * MAX_CHANNELS * sizeof(opus_int16) * 2,
+        .native_plc = 1,
+};
+
+static struct ast_translator lin32toopus = {
+        .table_cost = AST_TRANS_COST_LL_LY_UPSAMP,
+        .name = "lin32toopus",
+        .src_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 32000,
+        },
+        .dst_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .format = "opus",
+        .newpvt = lintoopus_new,
+        .framein = resampletoopus_framein,
+        .frameout = lintoopus_frameout,
+        .destroy = lintoopus_destroy,
+        .sample = slin32_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES,
+        .buf_size = BUFFER_SAMPLES * 2,
+};
+
+static struct ast_translator opustolin44 = {
+        .table_cost = AST_TRANS_COST_LY_LL_DOWNSAMP,
+        .name = "opustolin44",
+        .src_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .dst_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 44100,
+        },
+        .format = "slin44",
+        .newpvt = opustolin_new,
+        .framein = opustolin_framein,
+        .frameout = opustolin_frameout,
+        .destroy = opustolin_destroy,
+        .sample = opus_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES * 2, /* twice, because of possible FEC */
+        .buf_size = BUFFER_SAMPLES * MAX_CHANNELS * sizeof(opus_int16) * 2,
+        .native_plc = 1,
+};
+
+static struct ast_translator lin44toopus = {
+        .table_cost = AST_TRANS_COST_LL_LY_UPSAMP,
+        .name = "lin44toopus",
+        .src_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 44100,
+        },
+        .dst_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .format = "opus",
+        .newpvt = lintoopus_new,
+        .framein = resampletoopus_framein,
+        .frameout = lintoopus_frameout,
+        .destroy = lintoopus_destroy,
+        .sample = slin44_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES,
+        .buf_size = BUFFER_SAMPLES * 2,
+};
+
+static struct ast_translator opustolin48 = {
+        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP - 8,
+        .name = "opustolin48",
+        .src_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .dst_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .format = "slin48",
+        .newpvt = opustolin_new,
+        .framein = opustolin_framein,
+        .frameout = opustolin_frameout,
+        .destroy = opustolin_destroy,
+        .sample = opus_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES * 2, /* twice, because of possible FEC */
+        .buf_size = BUFFER_SAMPLES * MAX_CHANNELS * sizeof(opus_int16) * 2,
+        .native_plc = 1,
+};
+
+static struct ast_translator lin48toopus = {
+        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP - 8,
+        .name = "lin48toopus",
+        .src_codec = {
+                .name = "slin",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .dst_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .format = "opus",
+        .newpvt = lintoopus_new,
+        .framein = lintoopus_framein,
+        .frameout = lintoopus_frameout,
+        .destroy = lintoopus_destroy,
+        .sample = slin48_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES,
+        .buf_size = BUFFER_SAMPLES * 2,
+};
+
+static struct ast_translator opustoulaw = {
+        .table_cost = AST_TRANS_COST_LY_LY_DOWNSAMP,
+        .name = "opustoulaw",
+        .src_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .dst_codec = {
+                .name = "ulaw",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 8000,
+        },
+        .format = "ulaw",
+        .newpvt = opustoulaw_new,
+        .framein = opustolin_framein,
+        .frameout = opustolin_frameout,
+        .destroy = opustolin_destroy,
+        .sample = opus_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = (BUFFER_SAMPLES / (48000 / 8000)) * 2, /* because of possible FEC */
+        .buf_size = (BUFFER_SAMPLES / (48000 / 8000)) * 2,
+        .native_plc = 1,
+};
+
+static struct ast_translator ulawtoopus = {
+        .table_cost = AST_TRANS_COST_LY_LY_UPSAMP,
+        .name = "ulawtoopus",
+        .src_codec = {
+                .name = "ulaw",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 8000,
+        },
+        .dst_codec = {
+                .name = "opus",
+                .type = AST_MEDIA_TYPE_AUDIO,
+                .sample_rate = 48000,
+        },
+        .format = "opus",
+        .newpvt = lintoopus_new,
+        .framein = ulawtoopus_framein,
+        .frameout = lintoopus_frameout,
+        .destroy = lintoopus_destroy,
+        .sample = ulaw_sample,
+        .desc_size = sizeof(struct opus_coder_pvt),
+        .buffer_samples = BUFFER_SAMPLES,
+        .buf_size = BUFFER_SAMPLES * 2,
+};
+
+static struct ast_translator opustoalaw = {
+        .table_cost = AST_TRANS_COST_LY_LY_DOWNSAMP,
+        .name = "opustoalaw",
         .src_codec = {
                 .name = "opus",
                 .type = AST_MEDIA_TYPE_AUDIO,
                 .sample_rate = 48000,
         },
         .dst_codec = {
-                .name = "slin",
+                .name = "alaw",
                 .type = AST_MEDIA_TYPE_AUDIO,
                 .sample_rate = 8000,
         },
-        .format = "slin",
-        .newpvt = opustolin_new,
+        .format = "alaw",
+        .newpvt = opustoalaw_new,
         .framein = opustolin_framein,
+        .frameout = opustolin_frameout,
         .destroy = opustolin_destroy,
         .sample = opus_sample,
         .desc_size = sizeof(struct opus_coder_pvt),
         .buffer_samples = (BUFFER_SAMPLES / (48000 / 8000)) * 2, /* because of possible FEC */
-        .buf_size = (BUFFER_SAMPLES / (48000 / 8000)) * MAX_CHANNELS * sizeof(opus_int16) * 2,
+        .buf_size = (BUFFER_SAMPLES / (48000 / 8000)) * 2,
         .native_plc = 1,
 };
 
-static struct ast_translator lintoopus = {
-        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP,
-        .name = "lintoopus",
+static struct ast_translator alawtoopus = {
+        .table_cost = AST_TRANS_COST_LY_LY_UPSAMP,
+        .name = "alawtoopus",
         .src_codec = {
-                .name = "slin",
+                .name = "alaw",
                 .type = AST_MEDIA_TYPE_AUDIO,
                 .sample_rate = 8000,
         },
@@ -584,206 +2655,912 @@ static struct ast_translator lintoopus = {
         },
         .format = "opus",
         .newpvt = lintoopus_new,
-        .framein = lintoopus_framein,
+        .framein = alawtoopus_framein,
         .frameout = lintoopus_frameout,
         .destroy = lintoopus_destroy,
-        .sample = slin8_sample,
+        .sample = alaw_sample,
         .desc_size = sizeof(struct opus_coder_pvt),
         .buffer_samples = BUFFER_SAMPLES,
         .buf_size = BUFFER_SAMPLES * 2,
 };
 
-static struct ast_translator opustolin12 = {
-        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP - 1,
-        .name = "opustolin12",
-        .src_codec = {
-                .name = "opus",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .dst_codec = {
-                .name = "slin",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 12000,
-        },
-        .format = "slin12",
-        .newpvt = opustolin_new,
-        .framein = opustolin_framein,
-        .destroy = opustolin_destroy,
-        .sample = opus_sample,
-        .desc_size = sizeof(struct opus_coder_pvt),
-        .buffer_samples = (BUFFER_SAMPLES / (48000 / 12000)) * 2, /* because of possible FEC */
-        .buf_size = (BUFFER_SAMPLES / (48000 / 12000)) * MAX_CHANNELS * sizeof(opus_int16) * 2,
-        .native_plc = 1,
-};
+/*!
+ * \brief All translators with their tier in the cost table
+ *
+ * Within its tier, the cost of a translator is a guess, unless it gets
+ * calibrated on load, see opus_calibrate().
+ */
+static struct opus_translator {
+	struct ast_translator *t;
+	const char *format; /* of the other side, for the option 'translators' */
+	const int tier;
+	const int guess;
+	int enabled; /* by the option 'translators', on load */
+	int registered;
+} translators[] = {
+	{ &opustolin,   "slin",   AST_TRANS_COST_LY_LL_ORIGSAMP, 0 },
+	{ &lintoopus,   "slin",   AST_TRANS_COST_LL_LY_ORIGSAMP, 0 },
+	{ &opustolin12, "slin12", AST_TRANS_COST_LY_LL_ORIGSAMP, 1 },
+	{ &lin12toopus, "slin12", AST_TRANS_COST_LL_LY_ORIGSAMP, 1 },
+	{ &opustolin16, "slin16", AST_TRANS_COST_LY_LL_ORIGSAMP, 2 },
+	{ &lin16toopus, "slin16", AST_TRANS_COST_LL_LY_ORIGSAMP, 2 },
+	{ &opustolin24, "slin24", AST_TRANS_COST_LY_LL_ORIGSAMP, 4 },
+	{ &lin24toopus, "slin24", AST_TRANS_COST_LL_LY_ORIGSAMP, 4 },
+	{ &opustolin32, "slin32", AST_TRANS_COST_LY_LL_DOWNSAMP, 0 },
+	{ &lin32toopus, "slin32", AST_TRANS_COST_LL_LY_UPSAMP,   0 },
+	{ &opustolin44, "slin44", AST_TRANS_COST_LY_LL_DOWNSAMP, 1 },
+	{ &lin44toopus, "slin44", AST_TRANS_COST_LL_LY_UPSAMP,   1 },
+	{ &opustolin48, "slin48", AST_TRANS_COST_LY_LL_ORIGSAMP, 8 },
+	{ &lin48toopus, "slin48", AST_TRANS_COST_LL_LY_ORIGSAMP, 8 },
+	{ &opustoulaw,  "ulaw",   AST_TRANS_COST_LY_LY_DOWNSAMP, 0 },
+	{ &ulawtoopus,  "ulaw",   AST_TRANS_COST_LY_LY_UPSAMP,   0 },
+	{ &opustoalaw,  "alaw",   AST_TRANS_COST_LY_LY_DOWNSAMP, 0 },
+	{ &alawtoopus,  "alaw",   AST_TRANS_COST_LY_LY_UPSAMP,   0 },
+};
+
+/*!
+ * \brief Enable the translators from and to the formats in a list
+ *
+ * Each registered translator makes the core rebuild its translation
+ * matrix, therefore only the formats which occur in the setup should be
+ * in the list. Without the option, all translators get registered.
+ */
+static void opus_translators_enable(const char *value)
+{
+	char *formats;
+	char *format;
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(translators); i++) {
+		translators[i].enabled = !value;
+	}
+	if (!value) {
+		return;
+	}
+
+	formats = ast_strdupa(value);
+	while ((format = strsep(&formats, ","))) {
+		int found = 0;
+
+		format = ast_strip(format);
+		for (i = 0; i < ARRAY_LEN(translators); i++) {
+			if (!strcasecmp(translators[i].format, format)) {
+				translators[i].enabled = 1;
+				found = 1;
+			}
+		}
+		if (!found && !ast_strlen_zero(format)) {
+			ast_log(LOG_WARNING, "Unknown format '%s' in the translators of codec_opus.conf\n", format);
+		}
+	}
+}
+
+/*! \brief Whether an enabled translator has to resample, see opus_resample.h */
+static int opus_translators_resample(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(translators); i++) {
+		const struct ast_translator *t = translators[i].t;
+
+		if (translators[i].enabled && (opus_native_rate(t->src_codec.sample_rate) != t->src_codec.sample_rate
+			|| opus_native_rate(t->dst_codec.sample_rate) != t->dst_codec.sample_rate)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Calibrated costs stay within the tier: 1 per 100 ns per frame */
+#define	CALIBRATION_RANGE	10000
+#define	CALIBRATION_FRAMES	50
+
+static int calibrate_costs;
+
+static long long thread_cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*!
+ * \brief An instance of a translator, built like the core does
+ *
+ * The core cannot build one before the translator is registered, but the
+ * costs have to be known by then.
+ */
+static struct ast_trans_pvt *opus_calibrate_newpvt(struct ast_translator *t)
+{
+	struct ast_trans_pvt *pvt = ast_calloc(1, sizeof(*pvt) + t->desc_size + AST_FRIENDLY_OFFSET + t->buf_size);
+
+	if (!pvt) {
+		return NULL;
+	}
+	pvt->t = t;
+	pvt->pvt = pvt + 1;
+	pvt->outbuf.c = (char *) (pvt + 1) + t->desc_size + AST_FRIENDLY_OFFSET;
+	pvt->f.frametype = AST_FRAME_VOICE;
+	pvt->f.offset = AST_FRIENDLY_OFFSET;
+	pvt->f.src = t->name;
+	pvt->f.data.ptr = pvt->outbuf.c;
+
+	if (t->newpvt && t->newpvt(pvt)) {
+		ast_free(pvt);
+		return NULL;
+	}
+
+	return pvt;
+}
+
+/*! \brief One sample frame in and out, with timing info, like from RTP */
+static int opus_calibrate_frame(struct ast_trans_pvt *pvt, const struct ast_frame *sample, int seqno)
+{
+	struct ast_frame f = *sample;
+	struct ast_frame *out;
+
+	ast_set_flag(&f, AST_FRFLAG_HAS_TIMING_INFO);
+	f.seqno = seqno;
+	f.ts = seqno * 20;
+
+	if (pvt->t->framein(pvt, &f)) {
+		return -1;
+	}
+	out = pvt->t->frameout(pvt);
+	if (out) {
+		ast_frfree(out);
+	}
+
+	return 0;
+}
+
+/*!
+ * \brief Time the sample frame of a translator through its callbacks
+ *
+ * Includes all the translator does per frame, like companding, resampling,
+ * and the playout buffer, so the fused translators compare fairly with the
+ * paths through several.
+ *
+ * \return CPU time in nanoseconds per frame, or -1 on error
+ */
+static long long opus_calibrate(struct ast_translator *t)
+{
+	struct ast_frame *sample = t->sample ? t->sample() : NULL;
+	struct ast_trans_pvt *pvt;
+	long long start;
+	long long elapsed = -1;
+	int i;
+
+	if (!sample || !t->framein || !t->frameout) {
+		return -1;
+	}
+	pvt = opus_calibrate_newpvt(t);
+	if (!pvt) {
+		return -1;
+	}
+
+	/* the first frame constructs the coder, which a call pays once */
+	if (!opus_calibrate_frame(pvt, sample, 0)) {
+		start = thread_cpu_ns();
+		for (i = 1; i <= CALIBRATION_FRAMES; i++) {
+			if (opus_calibrate_frame(pvt, sample, i)) {
+				break;
+			}
+		}
+		if (CALIBRATION_FRAMES < i) {
+			elapsed = (thread_cpu_ns() - start) / CALIBRATION_FRAMES;
+		}
+	}
+
+	if (t->destroy) {
+		t->destroy(pvt);
+	}
+	ast_free(pvt);
+
+	return elapsed;
+}
+
+/*!
+ * \brief Set the table cost of each translator before it gets registered
+ */
+static void opus_translator_costs(void)
+{
+	const int tones = tone_cache;
+	int i;
+
+	/* the sample frame repeats; a cached packet would cost nothing */
+	tone_cache = 0;
+	for (i = 0; i < ARRAY_LEN(translators); i++) {
+		struct ast_translator *t = translators[i].t;
+		const long long ns = calibrate_costs && translators[i].enabled ? opus_calibrate(t) : -1;
+
+		if (ns < 0) {
+			t->table_cost = translators[i].tier - translators[i].guess;
+			continue;
+		}
+		t->table_cost = translators[i].tier - CALIBRATION_RANGE + MIN(ns / 100, CALIBRATION_RANGE - 1);
+		ast_verb(4, "Opus translator %s takes %lld ns per frame, cost %d\n", t->name, ns, t->table_cost);
+	}
+	tone_cache = tones;
+}
+
+static void load_profile(struct ast_config *cfg, const char *name, struct opus_profile *prof)
+{
+	struct ast_variable *var = ast_variable_browse(cfg, name);
+	int value;
+
+	*prof = default_profile;
+
+	if (!var) {
+		ast_log(LOG_WARNING, "Profile '%s' is missing in codec_opus.conf; using the defaults\n", name);
+	}
+
+	for (; var; var = var->next) {
+		if (!strcasecmp(var->name, "application")) {
+			if (!strcasecmp(var->value, "voip")) {
+				prof->application = OPUS_APPLICATION_VOIP;
+			} else if (!strcasecmp(var->value, "audio")) {
+				prof->application = OPUS_APPLICATION_AUDIO;
+			} else if (!strcasecmp(var->value, "restricted_lowdelay")) {
+				prof->application = OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+			} else {
+				ast_log(LOG_WARNING, "Invalid application '%s' at line %d of codec_opus.conf\n", var->value, var->lineno);
+			}
+		} else if (!strcasecmp(var->name, "complexity")) {
+			if (sscanf(var->value, "%30d", &value) == 1 && 0 <= value && value <= 10) {
+				prof->complexity = value;
+			} else {
+				ast_log(LOG_WARNING, "Invalid complexity '%s' at line %d of codec_opus.conf\n", var->value, var->lineno);
+			}
+		} else if (!strcasecmp(var->name, "signal")) {
+			if (!strcasecmp(var->value, "auto")) {
+				prof->signal = OPUS_AUTO;
+			} else if (!strcasecmp(var->value, "voice")) {
+				prof->signal = OPUS_SIGNAL_VOICE;
+			} else if (!strcasecmp(var->value, "music")) {
+				prof->signal = OPUS_SIGNAL_MUSIC;
+			} else {
+				ast_log(LOG_WARNING, "Invalid signal '%s' at line %d of codec_opus.conf\n", var->value, var->lineno);
+			}
+		} else if (!strcasecmp(var->name, "frame_duration")) {
+			if (sscanf(var->value, "%30d", &value) == 1
+				&& (value == 10 || value == 20 || value == 40 || value == 60)) {
+				prof->frame_duration = value;
+			} else {
+				ast_log(LOG_WARNING, "Invalid frame_duration '%s' at line %d of codec_opus.conf\n", var->value, var->lineno);
+			}
+		} else if (!strcasecmp(var->name, "bitrate")) {
+			if (!strcasecmp(var->value, "auto")) {
+				prof->bitrate = 0;
+			} else if (sscanf(var->value, "%30d", &value) == 1 && 500 <= value && value <= 512000) {
+				prof->bitrate = value;
+			} else {
+				ast_log(LOG_WARNING, "Invalid bitrate '%s' at line %d of codec_opus.conf\n", var->value, var->lineno);
+			}
+		} else if (!strcasecmp(var->name, "packet_loss")) {
+			if (sscanf(var->value, "%30d", &value) == 1 && 0 <= value && value <= 100) {
+				prof->packet_loss = value;
+			} else {
+				ast_log(LOG_WARNING, "Invalid packet_loss '%s' at line %d of codec_opus.conf\n", var->value, var->lineno);
+			}
+		} else {
+			ast_log(LOG_WARNING, "Unknown option '%s' at line %d of codec_opus.conf\n", var->name, var->lineno);
+		}
+	}
+}
+
+static int load_config(int reload)
+{
+	struct ast_flags config_flags = { reload ? CONFIG_FLAG_FILEUNCHANGED : 0 };
+	struct ast_config *cfg = ast_config_load("codec_opus.conf", config_flags);
+	struct opus_profile prof = default_profile;
+	const char *value;
+	int running = 0;
+	int budget = 0;
+	int skip = 0;
+	int tones = 0;
+	int plc = PLC_TIER_CLASSIC;
+	int plc_percent = 0;
+	int frame_ms = 20;
+
+	if (cfg == CONFIG_STATUS_FILEUNCHANGED) {
+		return 0;
+	}
+	if (cfg == CONFIG_STATUS_FILEINVALID) {
+		ast_log(LOG_ERROR, "codec_opus.conf is invalid; keeping the current settings\n");
+		return -1;
+	}
+
+	if (!reload) {
+		/* the translators get registered on load; a reload keeps them */
+		opus_translators_enable(cfg ? ast_variable_retrieve(cfg, "general", "translators") : NULL);
+	}
+
+	if (cfg) {
+		if (!reload && (value = ast_variable_retrieve(cfg, "general", "calibrate_costs"))) {
+			/* the costs are set on registration; a reload keeps them */
+			calibrate_costs = ast_true(value);
+		}
+		if ((value = ast_variable_retrieve(cfg, "general", "reconfigure_running"))) {
+			running = ast_true(value);
+		}
+		if ((value = ast_variable_retrieve(cfg, "general", "profile"))) {
+			load_profile(cfg, value, &prof);
+		}
+		if ((value = ast_variable_retrieve(cfg, "general", "skip_silence"))) {
+			skip = ast_true(value);
+		}
+		if ((value = ast_variable_retrieve(cfg, "general", "tone_cache"))) {
+			tones = ast_true(value);
+		}
+		if ((value = ast_variable_retrieve(cfg, "general", "decoder_frame_duration"))
+			&& (sscanf(value, "%30d", &frame_ms) != 1
+				|| (frame_ms != 0 && frame_ms != 10 && frame_ms != 20 && frame_ms != 40 && frame_ms != 60))) {
+			ast_log(LOG_WARNING, "Invalid decoder_frame_duration '%s' in codec_opus.conf\n", value);
+			frame_ms = 20;
+		}
+		if ((value = ast_variable_retrieve(cfg, "general", "plc"))) {
+			if (!strcasecmp(value, "strong")) {
+				plc = PLC_TIER_STRONG;
+			} else if (!strcasecmp(value, "noise")) {
+				plc = PLC_TIER_NOISE;
+			} else if (strcasecmp(value, "classic")) {
+				ast_log(LOG_WARNING, "Invalid plc '%s' in codec_opus.conf\n", value);
+			}
+		}
+		if ((value = ast_variable_retrieve(cfg, "general", "plc_budget"))
+			&& (sscanf(value, "%30d", &plc_percent) != 1 || plc_percent < 0 || 10000 < plc_percent)) {
+			ast_log(LOG_WARNING, "Invalid plc_budget '%s' in codec_opus.conf\n", value);
+			plc_percent = 0;
+		}
+		if ((value = ast_variable_retrieve(cfg, "general", "flight_budget_us"))
+			&& (sscanf(value, "%30d", &budget) != 1 || budget < 0)) {
+			ast_log(LOG_WARNING, "Invalid flight_budget_us '%s' in codec_opus.conf\n", value);
+			budget = 0;
+		}
+		ast_config_destroy(cfg);
+	}
+
+	flight_budget_us = budget;
+	skip_silence = skip;
+	tone_cache = tones;
+	decoder_frame_ms = frame_ms;
+	plc_budget.tier = plc; /* strong applies to new decoders */
+	plc_budget.cpu_percent = plc_percent;
+
+	ast_rwlock_wrlock(&profile_lock);
+	profile = prof;
+	profile_generation++;
+	reconfigure_running = running;
+	ast_rwlock_unlock(&profile_lock);
+
+	return 0;
+}
+
+/*
+ * Benchmark: each channel has an encoding (slin -> opus) and a decoding
+ * (opus -> slin) translation path, built by the core like for a real call,
+ * therefore through the very callbacks of this module. Its frames carry
+ * timing info like those from RTP, which the core keeps on the packets, so
+ * the decoders run their playout buffer. The channels are spread across
+ * worker threads; every 20 ms, each thread runs all its channels once. A
+ * tick which ends after its deadline is a miss. From the CPU time per
+ * channel, the channels which fit into the real-time budget of one core
+ * get estimated. The CLI waits for the run, hence its cap.
+ *
+ * For G.711, the channels run once through the paths the core builds, which
+ * are the fused translators, and once through two hops via slin, built as
+ * two paths, like without them.
+ */
+#define	BENCHMARK_TICK_NS	20000000LL
+#define	BENCHMARK_MAX_CHANNELS	100000
+#define	BENCHMARK_MAX_THREADS	256
+#define	BENCHMARK_MAX_SECONDS	60
+
+#if defined(RUSAGE_THREAD)
+#define	BENCHMARK_RUSAGE	RUSAGE_THREAD
+#else
+#define	BENCHMARK_RUSAGE	RUSAGE_SELF	/* whole process, just an indication */
+#endif
+
+struct opus_benchmark_worker {
+	pthread_t thread;
+	int channels;
+	int ticks;
+	struct ast_format *format;	/* which the channels send and receive */
+	int via_slin;	/* two hops instead of the path of the core */
+	/* results */
+	int failed;
+	int misses;
+	long long cpu_ns;
+	long long worst_ns;	/* wall time of the longest tick */
+	long long cache_misses;	/* -1 = no perf events */
+	long context_switches;
+	long involuntary_switches;
+};
+
+/*! \brief Count the cache misses of the calling thread, if perf events are available */
+static int opus_benchmark_perf_open(void)
+{
+#if defined(__linux__) && defined(__NR_perf_event_open)
+	struct perf_event_attr pe;
+
+	memset(&pe, 0, sizeof(pe));
+	pe.type = PERF_TYPE_HARDWARE;
+	pe.size = sizeof(pe);
+	pe.config = PERF_COUNT_HW_CACHE_MISSES;
+	pe.exclude_kernel = 1;
+	pe.exclude_hv = 1;
+
+	return syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+/*!
+ * \brief Build the translation path of one direction of a channel
+ *
+ * \param path Two steps; the second one only via slin
+ */
+static int opus_benchmark_path(struct ast_trans_pvt **path, struct ast_format *dst, struct ast_format *src, int via_slin)
+{
+	if (!via_slin) {
+		path[0] = ast_translator_build_path(dst, src);
+		return path[0] ? 0 : -1;
+	}
+
+	path[0] = ast_translator_build_path(ast_format_slin, src);
+	path[1] = ast_translator_build_path(dst, ast_format_slin);
+
+	return path[0] && path[1] ? 0 : -1;
+}
+
+static void opus_benchmark_path_free(struct ast_trans_pvt **path)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (path[i]) {
+			ast_translator_free_path(path[i]);
+		}
+	}
+}
+
+static struct ast_frame *opus_benchmark_translate(struct ast_trans_pvt **path, struct ast_frame *f)
+{
+	struct ast_frame *out = ast_translate(path[0], f, 0);
+	struct ast_frame *next;
+
+	if (!out || !path[1]) {
+		return out;
+	}
+	next = ast_translate(path[1], out, 0);
+	ast_frfree(out);
+
+	return next;
+}
+
+static void *opus_benchmark_worker(void *data)
+{
+	struct opus_benchmark_worker *w = data;
+	struct ast_trans_pvt *(*encoders)[2] = ast_calloc(w->channels, sizeof(*encoders));
+	struct ast_trans_pvt *(*decoders)[2] = ast_calloc(w->channels, sizeof(*decoders));
+	const struct ast_frame *input = ast_format_cmp(w->format, ast_format_ulaw) == AST_FORMAT_CMP_EQUAL ? ulaw_sample()
+		: ast_format_cmp(w->format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL ? alaw_sample() : slin8_sample();
+	struct rusage before;
+	struct rusage after;
+	long long deadline;
+	long long cpu;
+	int perf_fd;
+	int tick;
+	int i;
+
+	w->cache_misses = -1;
+
+	for (i = 0; encoders && decoders && i < w->channels; i++) {
+		if (opus_benchmark_path(encoders[i], ast_format_opus, w->format, w->via_slin)
+			|| opus_benchmark_path(decoders[i], w->format, ast_format_opus, w->via_slin)) {
+			w->failed = 1;
+			break;
+		}
+	}
+	if (!encoders || !decoders || w->failed) {
+		w->failed = 1;
+		goto cleanup;
+	}
+
+	perf_fd = opus_benchmark_perf_open();
+	getrusage(BENCHMARK_RUSAGE, &before);
+	cpu = thread_cpu_ns();
+	deadline = monotonic_ns();
+
+	for (tick = 0; tick < w->ticks; tick++) {
+		const long long start = monotonic_ns();
+		struct ast_frame sample = *input;
+		long long now;
+
+		deadline += BENCHMARK_TICK_NS;
+
+		ast_set_flag(&sample, AST_FRFLAG_HAS_TIMING_INFO);
+		sample.seqno = tick & 0xffff;
+		sample.ts = tick * 20;
+		sample.len = 20;
+
+		for (i = 0; i < w->channels; i++) {
+			struct ast_frame *encoded = opus_benchmark_translate(encoders[i], &sample);
+			struct ast_frame *decoded;
+
+			if (!encoded) {
+				continue;
+			}
+			decoded = opus_benchmark_translate(decoders[i], encoded);
+			if (decoded) {
+				ast_frfree(decoded);
+			}
+			ast_frfree(encoded);
+		}
+
+		now = monotonic_ns();
+		w->worst_ns = MAX(w->worst_ns, now - start);
+		if (deadline < now) {
+			/* no catching up, that would just spread the miss */
+			w->misses++;
+			deadline = now;
+		} else {
+			struct timespec ts = { deadline / 1000000000LL, deadline % 1000000000LL };
+
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		}
+	}
+
+	w->cpu_ns = thread_cpu_ns() - cpu;
+	getrusage(BENCHMARK_RUSAGE, &after);
+	w->context_switches = after.ru_nvcsw - before.ru_nvcsw;
+	w->involuntary_switches = after.ru_nivcsw - before.ru_nivcsw;
+	if (perf_fd >= 0) {
+		long long count;
+
+		if (read(perf_fd, &count, sizeof(count)) == sizeof(count)) {
+			w->cache_misses = count;
+		}
+		close(perf_fd);
+	}
+
+cleanup:
+	for (i = 0; encoders && decoders && i < w->channels; i++) {
+		opus_benchmark_path_free(encoders[i]);
+		opus_benchmark_path_free(decoders[i]);
+	}
+	ast_free(encoders);
+	ast_free(decoders);
+
+	return NULL;
+}
+
+/*!
+ * \brief Run the channels on the threads, and report
+ *
+ * \param ns_per_channel The CPU time per channel and 20 ms
+ *
+ * \retval 0 on success
+ * \retval -1 the paths could not be built, or out of memory
+ */
+static int opus_benchmark_run(int fd, int channels, int threads, int seconds,
+	struct ast_format *format, int via_slin, long long *ns_per_channel)
+{
+	const long long channel_ticks = (long long) channels * seconds * 50;
+	struct opus_benchmark_worker *workers;
+	long long cpu_ns = 0;
+	long long worst_ns = 0;
+	long long cache_misses = 0;
+	long context_switches = 0;
+	long involuntary_switches = 0;
+	int misses = 0;
+	int failed = 0;
+	int started;
+	int i;
+
+	workers = ast_calloc(threads, sizeof(*workers));
+	if (!workers) {
+		return -1;
+	}
+
+	for (started = 0; started < threads; started++) {
+		struct opus_benchmark_worker *w = &workers[started];
+
+		w->channels = channels / threads + (started < channels % threads);
+		w->ticks = seconds * 50;
+		w->format = format;
+		w->via_slin = via_slin;
+		if (ast_pthread_create(&w->thread, NULL, opus_benchmark_worker, w)) {
+			ast_cli(fd, "Could not start benchmark thread %d.\n", started);
+			break;
+		}
+	}
+
+	for (i = 0; i < started; i++) {
+		struct opus_benchmark_worker *w = &workers[i];
+
+		pthread_join(w->thread, NULL);
+		failed |= w->failed;
+		misses += w->misses;
+		cpu_ns += w->cpu_ns;
+		worst_ns = MAX(worst_ns, w->worst_ns);
+		context_switches += w->context_switches;
+		involuntary_switches += w->involuntary_switches;
+		if (cache_misses < 0 || w->cache_misses < 0) {
+			cache_misses = -1;
+		} else {
+			cache_misses += w->cache_misses;
+		}
+	}
+	ast_free(workers);
+
+	if (failed || started < threads) {
+		ast_cli(fd, "Benchmark failed: no translation path between %s and opus, or out of memory.\n",
+			ast_format_get_name(format));
+		return -1;
+	}
+
+	*ns_per_channel = MAX(cpu_ns / channel_ticks, 1);
+
+	ast_cli(fd, "%d %s channels on %d threads for %d s%s:\n", channels, ast_format_get_name(format),
+		threads, seconds, via_slin ? ", via slin" : "");
+	ast_cli(fd, "  deadline misses:   %d of %d ticks\n", misses, threads * seconds * 50);
+	ast_cli(fd, "  longest tick:      %lld us\n", worst_ns / 1000);
+	ast_cli(fd, "  CPU per channel:   %lld us per 20 ms\n", *ns_per_channel / 1000);
+	ast_cli(fd, "  per core:          %lld channels in real time\n", BENCHMARK_TICK_NS / *ns_per_channel);
+	ast_cli(fd, "  on %d cores:       %lld channels in real time\n", threads, threads * BENCHMARK_TICK_NS / *ns_per_channel);
+	ast_cli(fd, "  context switches:  %ld voluntary, %ld involuntary\n", context_switches, involuntary_switches);
+	if (cache_misses < 0) {
+		ast_cli(fd, "  cache misses:      n/a (no perf events)\n");
+	} else {
+		ast_cli(fd, "  cache misses:      %lld per channel per 20 ms\n", cache_misses / channel_ticks);
+	}
+	ast_cli(fd, "%s\n", misses ? "The real-time budget was NOT met." : "The real-time budget was met.");
+
+	return 0;
+}
+
+static char *handle_cli_opus_benchmark(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ast_format *format = ast_format_slin;
+	long long fused_ns;
+	long long via_slin_ns;
+	int channels;
+	int threads;
+	int seconds = 10;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "opus benchmark";
+		e->usage =
+			"Usage: opus benchmark <channels> <threads> [<seconds> [ulaw|alaw]]\n"
+			"       Runs <channels> Opus encoder/decoder pairs on <threads>\n"
+			"       threads for <seconds> (default 10, at most 60) on a 20 ms\n"
+			"       tick, and reports deadline misses and the estimated capacity.\n"
+			"       With ulaw or alaw, runs the fused G.711 translators, then\n"
+			"       the same via slin, and compares them; that takes twice as long.\n"
+			"       Takes CPU from real calls; do not run it in production.\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 5) {
+			static const char * const laws[] = { "ulaw", "alaw", NULL, };
+
+			return ast_cli_complete(a->word, laws, a->n);
+		}
+		return NULL;
+	}
+
+	if (a->argc < 4 || a->argc > 6) {
+		return CLI_SHOWUSAGE;
+	}
+	if (sscanf(a->argv[2], "%30d", &channels) != 1 || channels < 1 || BENCHMARK_MAX_CHANNELS < channels
+		|| sscanf(a->argv[3], "%30d", &threads) != 1 || threads < 1 || BENCHMARK_MAX_THREADS < threads
+		|| (a->argc >= 5 && (sscanf(a->argv[4], "%30d", &seconds) != 1 || seconds < 1 || BENCHMARK_MAX_SECONDS < seconds))) {
+		return CLI_SHOWUSAGE;
+	}
+	if (a->argc == 6) {
+		if (!strcasecmp(a->argv[5], "ulaw")) {
+			format = ast_format_ulaw;
+		} else if (!strcasecmp(a->argv[5], "alaw")) {
+			format = ast_format_alaw;
+		} else {
+			return CLI_SHOWUSAGE;
+		}
+	}
+	threads = MIN(threads, channels);
+
+	if (opus_benchmark_run(a->fd, channels, threads, seconds, format, 0, &fused_ns)) {
+		return CLI_SUCCESS;
+	}
+	if (format == ast_format_slin
+		|| opus_benchmark_run(a->fd, channels, threads, seconds, format, 1, &via_slin_ns)) {
+		return CLI_SUCCESS;
+	}
+
+	ast_cli(a->fd, "opus <-> %s takes %lld us per channel and 20 ms, via slin %lld us: %+lld%%\n",
+		ast_format_get_name(format), fused_ns / 1000, via_slin_ns / 1000,
+		(fused_ns - via_slin_ns) * 100 / via_slin_ns);
+
+	return CLI_SUCCESS;
+}
+
+/*
+ * Capacity: the CPU time per 20 ms of audio of one encoder and of one
+ * decoder, measured with the current profile at each sampling rate in use.
+ * The measurement runs in a thread of its own at the lowest priority, so it
+ * does not take the cores from the calls; the CLI waits for it. Measured is
+ * the CPU time of that thread, which the priority does not skew.
+ */
+#define	CAPACITY_FRAMES	100
+#define	CAPACITY_LOAD	80	/* percent of a core we plan with */
 
-static struct ast_translator lin12toopus = {
-        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP - 1,
-        .name = "lin12toopus",
-        .src_codec = {
-                .name = "slin",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 12000,
-        },
-        .dst_codec = {
-                .name = "opus",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .format = "opus",
-        .newpvt = lintoopus_new,
-        .framein = lintoopus_framein,
-        .frameout = lintoopus_frameout,
-        .destroy = lintoopus_destroy,
-        .desc_size = sizeof(struct opus_coder_pvt),
-        .buffer_samples = BUFFER_SAMPLES,
-        .buf_size = BUFFER_SAMPLES * 2,
+struct opus_capacity {
+	int sampling_rate;
+	struct opus_profile profile;
+	long long encoder_ns;	/* per 20 ms, -1 = error */
+	long long decoder_ns;
 };
 
-static struct ast_translator opustolin16 = {
-        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP - 2,
-        .name = "opustolin16",
-        .src_codec = {
-                .name = "opus",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .dst_codec = {
-                .name = "slin",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 16000,
-        },
-        .format = "slin16",
-        .newpvt = opustolin_new,
-        .framein = opustolin_framein,
-        .destroy = opustolin_destroy,
-        .sample = opus_sample,
-        .desc_size = sizeof(struct opus_coder_pvt),
-        .buffer_samples = (BUFFER_SAMPLES / (48000 / 16000)) * 2, /* because of possible FEC */
-        .buf_size = (BUFFER_SAMPLES / (48000 / 16000)) * MAX_CHANNELS * sizeof(opus_int16) * 2,
-        .native_plc = 1,
-};
+static void opus_capacity_measure(struct opus_capacity *c)
+{
+	const struct ast_frame *sample = slin8_sample();
+	const int frame_size = c->sampling_rate * c->profile.frame_duration / 1000;
+	unsigned char (*packets)[1275]; /* too large for the stack of the CLI */
+	opus_int32 lengths[CAPACITY_FRAMES];
+	opus_int16 pcm[BUFFER_SAMPLES];
+	OpusEncoder *encoder;
+	OpusDecoder *decoder;
+	long long start;
+	int status = 0;
+	int i;
 
-static struct ast_translator lin16toopus = {
-        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP - 2,
-        .name = "lin16toopus",
-        .src_codec = {
-                .name = "slin",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 16000,
-        },
-        .dst_codec = {
-                .name = "opus",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .format = "opus",
-        .newpvt = lintoopus_new,
-        .framein = lintoopus_framein,
-        .frameout = lintoopus_frameout,
-        .destroy = lintoopus_destroy,
-        .sample = slin16_sample,
-        .desc_size = sizeof(struct opus_coder_pvt),
-        .buffer_samples = BUFFER_SAMPLES,
-        .buf_size = BUFFER_SAMPLES * 2,
-};
+	c->encoder_ns = -1;
+	c->decoder_ns = -1;
 
-static struct ast_translator opustolin24 = {
-        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP - 4,
-        .name = "opustolin24",
-        .src_codec = {
-                .name = "opus",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .dst_codec = {
-                .name = "slin",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 24000,
-        },
-        .format = "slin24",
-        .newpvt = opustolin_new,
-        .framein = opustolin_framein,
-        .destroy = opustolin_destroy,
-        .sample = opus_sample,
-        .desc_size = sizeof(struct opus_coder_pvt),
-        .buffer_samples = (BUFFER_SAMPLES / (48000 / 24000)) * 2, /* because of possible FEC */
-        .buf_size = (BUFFER_SAMPLES / (48000 / 24000)) * MAX_CHANNELS * sizeof(opus_int16) * 2,
-        .native_plc = 1,
-};
+	for (i = 0; i < frame_size; i++) {
+		/* the 8 kHz sample just repeated; the encoder sees voice anyway */
+		pcm[i] = ((int16_t *) sample->data.ptr)[i % sample->samples];
+	}
 
-static struct ast_translator lin24toopus = {
-        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP - 4,
-        .name = "lin24toopus",
-        .src_codec = {
-                .name = "slin",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 24000,
-        },
-        .dst_codec = {
-                .name = "opus",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .format = "opus",
-        .newpvt = lintoopus_new,
-        .framein = lintoopus_framein,
-        .frameout = lintoopus_frameout,
-        .destroy = lintoopus_destroy,
-        .desc_size = sizeof(struct opus_coder_pvt),
-        .buffer_samples = BUFFER_SAMPLES,
-        .buf_size = BUFFER_SAMPLES * 2,
-};
+	packets = ast_malloc(CAPACITY_FRAMES * sizeof(*packets));
+	if (!packets) {
+		return;
+	}
 
-static struct ast_translator opustolin48 = {
-        .table_cost = AST_TRANS_COST_LY_LL_ORIGSAMP - 8,
-        .name = "opustolin48",
-        .src_codec = {
-                .name = "opus",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .dst_codec = {
-                .name = "slin",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .format = "slin48",
-        .newpvt = opustolin_new,
-        .framein = opustolin_framein,
-        .destroy = opustolin_destroy,
-        .sample = opus_sample,
-        .desc_size = sizeof(struct opus_coder_pvt),
-        .buffer_samples = BUFFER_SAMPLES * 2, /* twice, because of possible FEC */
-        .buf_size = BUFFER_SAMPLES * MAX_CHANNELS * sizeof(opus_int16) * 2,
-        .native_plc = 1,
-};
+	encoder = opus_encoder_create(c->sampling_rate, 1, c->profile.application, &status);
+	if (status != OPUS_OK) {
+		ast_free(packets);
+		return;
+	}
+	if (0 <= c->profile.complexity) {
+		opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(c->profile.complexity));
+	}
+	opus_encoder_ctl(encoder, OPUS_SET_SIGNAL(c->profile.signal));
+	opus_encoder_ctl(encoder, OPUS_SET_BITRATE(opus_bitrate(&default_attr, &c->profile)));
+	opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(default_attr.fec));
 
-static struct ast_translator lin48toopus = {
-        .table_cost = AST_TRANS_COST_LL_LY_ORIGSAMP - 8,
-        .name = "lin48toopus",
-        .src_codec = {
-                .name = "slin",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .dst_codec = {
-                .name = "opus",
-                .type = AST_MEDIA_TYPE_AUDIO,
-                .sample_rate = 48000,
-        },
-        .format = "opus",
-        .newpvt = lintoopus_new,
-        .framein = lintoopus_framein,
-        .frameout = lintoopus_frameout,
-        .destroy = lintoopus_destroy,
-        .desc_size = sizeof(struct opus_coder_pvt),
-        .buffer_samples = BUFFER_SAMPLES,
-        .buf_size = BUFFER_SAMPLES * 2,
-};
+	start = thread_cpu_ns();
+	for (i = 0; i < CAPACITY_FRAMES; i++) {
+		lengths[i] = opus_encode(encoder, pcm, frame_size, packets[i], sizeof(packets[i]));
+	}
+	c->encoder_ns = (thread_cpu_ns() - start) / CAPACITY_FRAMES * 20 / c->profile.frame_duration;
+	opus_encoder_destroy(encoder);
+
+	decoder = opus_decoder_create(c->sampling_rate, 1, &status);
+	if (status != OPUS_OK) {
+		c->encoder_ns = -1;
+		ast_free(packets);
+		return;
+	}
+	start = thread_cpu_ns();
+	for (i = 0; i < CAPACITY_FRAMES; i++) {
+		opus_decode(decoder, 0 < lengths[i] ? packets[i] : NULL, MAX(lengths[i], 0), pcm, frame_size, 0);
+	}
+	c->decoder_ns = (thread_cpu_ns() - start) / CAPACITY_FRAMES * 20 / c->profile.frame_duration;
+	opus_decoder_destroy(decoder);
+	ast_free(packets);
+}
+
+static void *opus_capacity_thread(void *data)
+{
+#if defined(SCHED_BATCH)
+	const struct sched_param param = { .sched_priority = 0, };
+
+	pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+#endif
+	/* the nice value of Linux applies to the thread */
+	setpriority(PRIO_PROCESS, ast_get_tid(), 19);
+
+	opus_capacity_measure(data);
+
+	return NULL;
+}
+
+static char *handle_cli_opus_capacity(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct opus_capacity c[ARRAY_LEN(opus_rates)];
+	struct opus_profile profile;
+	struct codec_usage copy;
+	const long cores = MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+	const long long budget = BENCHMARK_TICK_NS * CAPACITY_LOAD / 100; /* per core and 20 ms */
+	const struct opus_capacity *target;
+	pthread_t thread;
+	int sampling_rate = 8000;
+	long long load = 0;
+	long long remaining;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "opus capacity";
+		e->usage =
+			"Usage: opus capacity [<rate>]\n"
+			"       Measures encoding and decoding with the current profile\n"
+			"       at each rate in use and at <rate> (default 8000), and\n"
+			"       estimates how many more encoders/decoders at <rate> this\n"
+			"       machine can take, planning with " AST_STRINGIFY(CAPACITY_LOAD) "% of each core.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc < 2 || a->argc > 3) {
+		return CLI_SHOWUSAGE;
+	}
+	if (a->argc == 3 && (sscanf(a->argv[2], "%30d", &sampling_rate) != 1
+		|| opus_rates[opus_rate_index(sampling_rate)] != sampling_rate)) {
+		return CLI_SHOWUSAGE;
+	}
+	target = &c[opus_rate_index(sampling_rate)];
+
+	copy = usage;
+	opus_encoder_profile(&profile);
+	for (i = 0; i < ARRAY_LEN(opus_rates); i++) {
+		c[i].sampling_rate = opus_rates[i];
+		c[i].profile = profile;
+		c[i].encoder_ns = 0;
+		c[i].decoder_ns = 0;
+		if (&c[i] != target && !copy.encoders_at[i] && !copy.decoders_at[i]) {
+			continue;
+		}
+		if (ast_pthread_create(&thread, NULL, opus_capacity_thread, &c[i])) {
+			ast_cli(a->fd, "Could not start the measurement.\n");
+			return CLI_FAILURE;
+		}
+		pthread_join(thread, NULL);
+		if (c[i].encoder_ns <= 0 || c[i].decoder_ns <= 0) {
+			ast_cli(a->fd, "Could not measure the Opus library at %d Hz.\n", opus_rates[i]);
+			return CLI_FAILURE;
+		}
+		load += copy.encoders_at[i] * c[i].encoder_ns + copy.decoders_at[i] * c[i].decoder_ns;
+		ast_cli(a->fd, "Per 20 ms of audio at %5d Hz: encoder %lld us, decoder %lld us; %d/%d in use\n",
+			opus_rates[i], c[i].encoder_ns / 1000, c[i].decoder_ns / 1000, copy.encoders_at[i], copy.decoders_at[i]);
+	}
+	remaining = MAX(cores * budget - load, 0);
+
+	ast_cli(a->fd, "Per core (%d%%) at %d Hz: %lld encoders, %lld decoders, or %lld pairs\n",
+		CAPACITY_LOAD, sampling_rate, budget / target->encoder_ns, budget / target->decoder_ns,
+		budget / (target->encoder_ns + target->decoder_ns));
+	ast_cli(a->fd, "In use:            %d/%d encoders/decoders, about %lld%% of %ld cores\n",
+		copy.encoders, copy.decoders, load * 100 / (cores * BENCHMARK_TICK_NS), cores);
+	ast_cli(a->fd, "Remaining at %d Hz: %lld encoders, %lld decoders, or %lld pairs\n",
+		sampling_rate, remaining / target->encoder_ns, remaining / target->decoder_ns,
+		remaining / (target->encoder_ns + target->decoder_ns));
+
+	return CLI_SUCCESS;
+}
 
 static struct ast_cli_entry cli[] = {
-	AST_CLI_DEFINE(handle_cli_opus_show, "Display Opus codec utilization.")
+	AST_CLI_DEFINE(handle_cli_opus_show, "Display Opus codec utilization."),
+	AST_CLI_DEFINE(handle_cli_opus_show_flight, "Display the last frames of an Opus encoder/decoder."),
+	AST_CLI_DEFINE(handle_cli_opus_capacity, "Estimate the remaining Opus capacity."),
+	AST_CLI_DEFINE(handle_cli_opus_benchmark, "Measure the Opus capacity of this machine."),
 };
 
 static int opus_samples(struct ast_frame *frame)
@@ -795,58 +3572,116 @@ static int opus_samples(struct ast_frame *frame)
 
 static int reload(void)
 {
-	/* Reload does nothing */
+	if (load_config(1)) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
 static int unload_module(void)
 {
 	int res;
+	int i;
 
-	opus_codec->samples_count = opus_samples_previous;
-	ao2_ref(opus_codec, -1);
+	if (opus_codec) {
+		opus_codec->samples_count = opus_samples_previous;
+		ao2_ref(opus_codec, -1);
+		opus_codec = NULL;
+	}
 
-	res = ast_unregister_translator(&opustolin);
-	res |= ast_unregister_translator(&lintoopus);
-	res |= ast_unregister_translator(&opustolin12);
-	res |= ast_unregister_translator(&lin12toopus);
-	res |= ast_unregister_translator(&opustolin16);
-	res |= ast_unregister_translator(&lin16toopus);
-	res |= ast_unregister_translator(&opustolin24);
-	res |= ast_unregister_translator(&lin24toopus);
-	res |= ast_unregister_translator(&opustolin48);
-	res |= ast_unregister_translator(&lin48toopus);
+	res = 0;
+	for (i = 0; i < ARRAY_LEN(translators); i++) {
+		if (translators[i].registered) {
+			res |= ast_unregister_translator(translators[i].t);
+			translators[i].registered = 0;
+		}
+	}
 
 	ast_cli_unregister_multiple(cli, ARRAY_LEN(cli));
+	res |= ast_custom_function_unregister(&opus_record_function);
+
+	/* stops the timer first, which takes parked_lock */
+	if (parked_sched) {
+		ast_sched_context_destroy(parked_sched);
+		parked_sched = NULL;
+	}
+	ast_mutex_lock(&parked_lock);
+	opus_encoder_parked_expire(1);
+	parked_timer = -1;
+	ast_mutex_unlock(&parked_lock);
+
+	opus_resample_destroy_filters();
 
 	return res;
 }
 
 static int load_module(void)
 {
+	const struct timeval start = ast_tvnow();
 	int res;
+	int i;
+
+	opus_translators_enable(NULL); /* unless the configuration lists them */
+	load_config(0);
+	if (opus_translators_resample() && opus_resample_init()) {
+		opus_resample_destroy_filters();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+	comfort_noise_init();
+	ogg_crc_init();
+	g711_sample_init();
 
 	opus_codec = ast_codec_get("opus", AST_MEDIA_TYPE_AUDIO, 48000);
+	if (!opus_codec) {
+		opus_resample_destroy_filters();
+		return AST_MODULE_LOAD_DECLINE;
+	}
 	opus_samples_previous = opus_codec->samples_count;
 	opus_codec->samples_count = opus_samples;
 
-	res = ast_register_translator(&opustolin);
-	res |= ast_register_translator(&lintoopus);
-	res |= ast_register_translator(&opustolin12);
-	res |= ast_register_translator(&lin12toopus);
-	res |= ast_register_translator(&opustolin16);
-	res |= ast_register_translator(&lin16toopus);
-	res |= ast_register_translator(&opustolin24);
-	res |= ast_register_translator(&lin24toopus);
-	res |= ast_register_translator(&opustolin48);
-	res |= ast_register_translator(&lin48toopus);
+	opus_translator_costs();
 
-	ast_cli_register_multiple(cli, ARRAY_LEN(cli));
+	parked_sched = ast_sched_context_create();
+	if (parked_sched && ast_sched_start_thread(parked_sched)) {
+		ast_sched_context_destroy(parked_sched);
+		parked_sched = NULL;
+	}
+	if (!parked_sched) {
+		ast_log(LOG_WARNING, "Opus encoders do not get reused when a translation path is rebuilt\n");
+	}
 
-	return res;
+	res = 0;
+	load_registered = 0;
+	for (i = 0; i < ARRAY_LEN(translators); i++) {
+		if (!translators[i].enabled) {
+			continue;
+		}
+		if (ast_register_translator(translators[i].t)) {
+			res = -1;
+			break;
+		}
+		translators[i].registered = 1;
+		load_registered++;
+	}
+
+	if (!res) {
+		ast_cli_register_multiple(cli, ARRAY_LEN(cli));
+		res = ast_custom_function_register(&opus_record_function);
+	}
+	if (res) {
+		/* the same teardown, of whatever got this far */
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	load_ms = ast_tvdiff_ms(ast_tvnow(), start);
+	ast_verb(2, "Registered %d of %d Opus translators in %ld ms\n", load_registered, (int) ARRAY_LEN(translators), load_ms);
+
+	return AST_MODULE_LOAD_SUCCESS;
 }
 
-AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "Opus Coder/Decoder",
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_GLOBAL_SYMBOLS, "Opus Coder/Decoder",
 	.load = load_module,
 	.unload = unload_module,
 	.reload = reload,
@@ -0,0 +1,515 @@
+/*! \file
+ * \brief Signed 16-bit audio data at 12, 24, 32, 44.1, and 48 kHz
+ *
+ * Distributed under the terms of the GNU General Public License
+ *
+ */
+
+#include "asterisk/format_cache.h"      /* for ast_format_slin12, etc */
+#include "asterisk/frame.h"             /* for ast_frame, etc */
+
+/* Voiced speech at 12 kHz, a 20ms sample */
+static uint16_t ex_slin12[] = {
+	0xff54, 0xfea4, 0xfe2a, 0xfe30, 0xfdf6, 0xfe9e, 0xfee5, 0xffeb,
+	0x0060, 0x0114, 0x014b, 0x0163, 0x0161, 0x0114, 0x0110, 0x00ad,
+	0x00be, 0x0071, 0x0088, 0x005f, 0x0065, 0x005f, 0x0049, 0x0060,
+	0x0033, 0x0058, 0x0023, 0x0045, 0x001b, 0x002b, 0x0018, 0x000d,
+	0x0016, 0xfff2, 0x000f, 0xffdd, 0x0000, 0xffd1, 0xffe9, 0xffcb,
+	0xffcc, 0xffca, 0xffaf, 0xffc8, 0xff99, 0xffc1, 0xff8c, 0xffb0,
+	0xff83, 0xff8c, 0xff6f, 0xff46, 0xff37, 0xfede, 0xfee2, 0xfe82,
+	0xfeb9, 0xfeab, 0xff3e, 0xffbd, 0x007f, 0x0143, 0x019a, 0x0218,
+	0x01b3, 0x01d9, 0x00f5, 0x008b, 0xfea6, 0xfc34, 0xf84f, 0xf392,
+	0xf01a, 0xed17, 0xefc8, 0xf0bb, 0xfcaa, 0x0d65, 0x0fc0, 0x1261,
+	0x115a, 0x0d76, 0x097d, 0x04b5, 0x023f, 0xffcd, 0xff40, 0xfe59,
+	0xfe41, 0xfe09, 0xfe24, 0xfeb0, 0xff22, 0x0020, 0x0083, 0x0141,
+	0x0142, 0x0179, 0x013f, 0x011c, 0x00f1, 0x00ae, 0x00b0, 0x006a,
+	0x008b, 0x004f, 0x0073, 0x004b, 0x005a, 0x004d, 0x003f, 0x004d,
+	0x0025, 0x0045, 0x0011, 0x0034, 0x0007, 0x001c, 0x0002, 0xffff,
+	0x0000, 0xffe2, 0xfffb, 0xffcb, 0xffef, 0xffbd, 0xffda, 0xffb6,
+	0xffbf, 0xffb6, 0xffa3, 0xffb8, 0xff8c, 0xffb2, 0xff75, 0xff96,
+	0xff53, 0xff51, 0xff15, 0xfee3, 0xfec6, 0xfe85, 0xfebf, 0xfeba,
+	0xff76, 0xffd9, 0x00d2, 0x014e, 0x01d4, 0x01fd, 0x01bc, 0x01b0,
+	0x00c5, 0x0043, 0xfddf, 0xfb6f, 0xf6c0, 0xf2ac, 0xeed6, 0xed81,
+	0xf039, 0xf23d, 0x0273, 0x0f1f, 0x101f, 0x12e4, 0x1018, 0x0c94,
+	0x07ee, 0x03e7, 0x017a, 0xff7d, 0xff14, 0xfe2b, 0xfe4d, 0xfdea,
+	0xfe5d, 0xfebb, 0xff74, 0x003f, 0x00b9, 0x0154, 0x0145, 0x017f,
+	0x0122, 0x0122, 0x00ce, 0x00b8, 0x0096, 0x0072, 0x0080, 0x004f,
+	0x0075, 0x0040, 0x0066, 0x003a, 0x004e, 0x0039, 0x0031, 0x0037,
+	0x0015, 0x0031, 0x0000, 0x0023, 0xfff3, 0x000d, 0xffed, 0xfff1,
+	0xffeb, 0xffd3, 0xffe7, 0xffba, 0xffdd, 0xffa9, 0xffcc, 0xffa3,
+	0xffb4, 0xffa4, 0xff99, 0xffa5, 0xff77, 0xff91, 0xff43, 0xff54,
+	0xfef4, 0xfeeb, 0xfea4, 0xfe99, 0xfeb6, 0xfee4, 0xff9c, 0x000b,
+	0x0113, 0x015e, 0x0205, 0x01d6, 0x01d3, 0x0169, 0x00ae, 0xffbf,
+};
+
+/* Voiced speech at 24 kHz, a 20ms sample */
+static uint16_t ex_slin24[] = {
+	0xff78, 0xff0f, 0xfe7b, 0xfe3b, 0xfe55, 0xfe51, 0xfe06, 0xfddf,
+	0xfe1b, 0xfe6a, 0xfe80, 0xfe95, 0xfef9, 0xff87, 0xffe2, 0x000e,
+	0x005c, 0x00d4, 0x0124, 0x012c, 0x0131, 0x0161, 0x0186, 0x016c,
+	0x0139, 0x0130, 0x0140, 0x0125, 0x00e6, 0x00c7, 0x00d3, 0x00cf,
+	0x00a0, 0x007b, 0x0086, 0x0097, 0x007f, 0x0059, 0x005c, 0x0078,
+	0x0073, 0x0050, 0x0046, 0x0060, 0x006c, 0x004f, 0x0037, 0x0048,
+	0x005e, 0x004d, 0x002d, 0x0030, 0x004a, 0x0046, 0x0025, 0x001a,
+	0x0031, 0x003b, 0x0020, 0x0008, 0x0017, 0x002b, 0x001a, 0xfffb,
+	0xfffd, 0x0016, 0x0013, 0xfff3, 0xffe7, 0xfffd, 0x0008, 0xffed,
+	0xffd5, 0xffe3, 0xfff8, 0xffe8, 0xffc9, 0xffca, 0xffe3, 0xffe1,
+	0xffc0, 0xffb3, 0xffca, 0xffd6, 0xffbb, 0xffa2, 0xffb1, 0xffc8,
+	0xffb9, 0xff98, 0xff9a, 0xffb6, 0xffb6, 0xff94, 0xff85, 0xff9e,
+	0xffab, 0xff8b, 0xff6a, 0xff74, 0xff87, 0xff6c, 0xff39, 0xff2a,
+	0xff39, 0xff26, 0xfee9, 0xfec1, 0xfecc, 0xfece, 0xfea1, 0xfe7a,
+	0xfe93, 0xfec7, 0xfed6, 0xfed5, 0xff13, 0xff8a, 0xffe5, 0x0012,
+	0x005d, 0x00e6, 0x015c, 0x017f, 0x018b, 0x01d0, 0x021b, 0x020b,
+	0x01bd, 0x01a5, 0x01c4, 0x019f, 0x0114, 0x0098, 0x0065, 0xfff5,
+	0xfed0, 0xfd52, 0xfc09, 0xfaa7, 0xf878, 0xf5b7, 0xf36f, 0xf1e3,
+	0xf034, 0xee21, 0xed07, 0xedfe, 0xefcc, 0xf076, 0xf0c3, 0xf43a,
+	0xfc97, 0x06b4, 0x0d83, 0x0f80, 0x0f9a, 0x10c3, 0x128b, 0x12d0,
+	0x112f, 0x0f28, 0x0da0, 0x0be4, 0x0959, 0x06af, 0x04d0, 0x038d,
+	0x022e, 0x00b9, 0xffd3, 0xff8c, 0xff47, 0xfeb7, 0xfe47, 0xfe46,
+	0xfe5d, 0xfe2a, 0xfde4, 0xfdf8, 0xfe4d, 0xfe7d, 0xfe85, 0xfec3,
+	0xff4c, 0xffc5, 0xfffc, 0x0033, 0x00a0, 0x010b, 0x012e, 0x012a,
+	0x0148, 0x017d, 0x017f, 0x014c, 0x012e, 0x013b, 0x0138, 0x0101,
+	0x00cd, 0x00cc, 0x00d7, 0x00b7, 0x0085, 0x007c, 0x0094, 0x008e,
+	0x0066, 0x0055, 0x006d, 0x007b, 0x0060, 0x0044, 0x0053, 0x006c,
+	0x005e, 0x003d, 0x003d, 0x0058, 0x0059, 0x0039, 0x002a, 0x0040,
+	0x004d, 0x0034, 0x001a, 0x0025, 0x003c, 0x002e, 0x000e, 0x000c,
+	0x0025, 0x0026, 0x0007, 0xfff7, 0x000c, 0x001a, 0x0002, 0xffe7,
+	0xfff2, 0x0008, 0xfffc, 0xffdc, 0xffd9, 0xfff2, 0xfff4, 0xffd4,
+	0xffc4, 0xffd8, 0xffe7, 0xffcf, 0xffb4, 0xffbe, 0xffd6, 0xffca,
+	0xffa9, 0xffa6, 0xffc1, 0xffc5, 0xffa5, 0xff93, 0xffaa, 0xffbc,
+	0xffa4, 0xff86, 0xff91, 0xffab, 0xff9d, 0xff74, 0xff6b, 0xff82,
+	0xff7e, 0xff4e, 0xff2a, 0xff33, 0xff35, 0xff05, 0xfecb, 0xfec4,
+	0xfed3, 0xfeb9, 0xfe85, 0xfe80, 0xfeb3, 0xfed5, 0xfed2, 0xfeee,
+	0xff55, 0xffc6, 0x0001, 0x0034, 0x00a7, 0x0133, 0x0179, 0x0182,
+	0x01ac, 0x0202, 0x021f, 0x01de, 0x01a4, 0x01b7, 0x01be, 0x0156,
+	0x00c3, 0x0078, 0x0038, 0xff63, 0xfdf5, 0xfc8f, 0xfb50, 0xf985,
+	0xf6e6, 0xf44d, 0xf282, 0xf100, 0xef01, 0xed45, 0xed59, 0xef13,
+	0xf05b, 0xf079, 0xf224, 0xf880, 0x0282, 0x0b39, 0x0f1d, 0x0f8a,
+	0x1015, 0x11d9, 0x12f8, 0x1209, 0x0ff9, 0x0e3e, 0x0cb9, 0x0a85,
+	0x07c4, 0x0581, 0x0412, 0x02ce, 0x0151, 0x001d, 0xffa0, 0xff6e,
+	0xfefa, 0xfe6a, 0xfe3b, 0xfe59, 0xfe49, 0xfdfc, 0xfde2, 0xfe28,
+	0xfe71, 0xfe81, 0xfe9d, 0xff0d, 0xff99, 0xffea, 0x0016, 0x006c,
+	0x00e4, 0x0129, 0x012b, 0x0135, 0x0169, 0x0187, 0x0164, 0x0134,
+	0x0133, 0x013f, 0x011d, 0x00de, 0x00c7, 0x00d5, 0x00ca, 0x0098,
+	0x0079, 0x008a, 0x0097, 0x0078, 0x0056, 0x0060, 0x007a, 0x006f,
+	0x004c, 0x0048, 0x0064, 0x0069, 0x004a, 0x0038, 0x004d, 0x005e,
+	0x0048, 0x002b, 0x0034, 0x004c, 0x0042, 0x0021, 0x001c, 0x0034,
+	0x0039, 0x001b, 0x0008, 0x001a, 0x002b, 0x0016, 0xfff9, 0x0001,
+	0x0018, 0x000f, 0xffef, 0xffe9, 0x0001, 0x0006, 0xffe9, 0xffd5,
+	0xffe7, 0xfff8, 0xffe3, 0xffc6, 0xffcd, 0xffe5, 0xffdd, 0xffbc,
+	0xffb5, 0xffce, 0xffd4, 0xffb6, 0xffa2, 0xffb5, 0xffc9, 0xffb4,
+	0xff96, 0xff9d, 0xffb9, 0xffb3, 0xff8f, 0xff87, 0xffa2, 0xffa9,
+	0xff85, 0xff69, 0xff78, 0xff86, 0xff65, 0xff34, 0xff2b, 0xff39,
+	0xff1f, 0xfee0, 0xfec0, 0xfece, 0xfeca, 0xfe99, 0xfe79, 0xfe9a,
+	0xfecc, 0xfed4, 0xfed9, 0xff22, 0xff9a, 0xffed, 0x0019, 0x006e,
+	0x00fb, 0x0166, 0x017f, 0x0191, 0x01dd, 0x021f, 0x0200, 0x01b4,
+	0x01a8, 0x01c5, 0x0190, 0x00fe, 0x008e, 0x005d, 0xffd7, 0xfe9b,
+};
+
+/* Voiced speech at 32 kHz, resampled from the one at 48 kHz, a 20ms sample */
+static uint16_t ex_slin32[] = {
+	0x01ac, 0x01c4, 0x01b2, 0x015f, 0x00ec, 0x0095, 0x0076, 0x0031,
+	0xffd4, 0xfe93, 0xfe6d, 0xff79, 0xfef6, 0xfe89, 0xfe48, 0xfe3c,
+	0xfe5b, 0xfe55, 0xfe25, 0xfded, 0xfde2, 0xfe10, 0xfe51, 0xfe79,
+	0xfe81, 0xfe8f, 0xfeca, 0xff2f, 0xff96, 0xffdb, 0xfffe, 0x0024,
+	0x006a, 0x00c5, 0x0110, 0x012d, 0x012b, 0x012e, 0x014c, 0x0175,
+	0x0187, 0x0172, 0x014a, 0x012f, 0x0132, 0x013f, 0x0136, 0x010e,
+	0x00df, 0x00c8, 0x00cd, 0x00d7, 0x00cb, 0x00a7, 0x0084, 0x007a,
+	0x0089, 0x0097, 0x008d, 0x006f, 0x0056, 0x0059, 0x006f, 0x007c,
+	0x006f, 0x0054, 0x0044, 0x004e, 0x0063, 0x006d, 0x005d, 0x0042,
+	0x0037, 0x0045, 0x0059, 0x005c, 0x0048, 0x0030, 0x002a, 0x003a,
+	0x004c, 0x0049, 0x0032, 0x001c, 0x001b, 0x002e, 0x003c, 0x0034,
+	0x001c, 0x0009, 0x000d, 0x0021, 0x002b, 0x001e, 0x0005, 0xfff7,
+	0x0000, 0x0014, 0x0019, 0x0008, 0xffef, 0xffe6, 0xfff3, 0x0005,
+	0x0006, 0xfff2, 0xffdb, 0xffd6, 0xffe6, 0xfff7, 0xfff3, 0xffdb,
+	0xffc7, 0xffc7, 0xffda, 0xffe7, 0xffde, 0xffc4, 0xffb3, 0xffb9,
+	0xffcd, 0xffd7, 0xffc8, 0xffae, 0xffa2, 0xffad, 0xffc2, 0xffc8,
+	0xffb5, 0xff9b, 0xff94, 0xffa4, 0xffb8, 0xffb9, 0xffa2, 0xff89,
+	0xff87, 0xff9a, 0xffab, 0xffa4, 0xff86, 0xff6c, 0xff6c, 0xff7e,
+	0xff87, 0xff72, 0xff4b, 0xff2d, 0xff2b, 0xff37, 0xff34, 0xff11,
+	0xfee1, 0xfec3, 0xfec5, 0xfed1, 0xfecb, 0xfea8, 0xfe83, 0xfe7b,
+	0xfe9a, 0xfec2, 0xfed6, 0xfed3, 0xfed8, 0xff07, 0xff5c, 0xffb3,
+	0xffec, 0x000d, 0x0039, 0x008c, 0x00f8, 0x0152, 0x017a, 0x0180,
+	0x0190, 0x01c5, 0x0206, 0x0222, 0x0202, 0x01c6, 0x01a3, 0x01b0,
+	0x01c5, 0x01aa, 0x014e, 0x00dc, 0x008f, 0x006b, 0x0032, 0xff9c,
+	0xfea1, 0xfd80, 0xfc7e, 0xfb93, 0xfa6f, 0xf8cb, 0xf6c0, 0xf4c2,
+	0xf337, 0xf211, 0xf0e7, 0xef6d, 0xede7, 0xed0e, 0xed6a, 0xeeb3,
+	0xeff7, 0xf074, 0xf07d, 0xf181, 0xf506, 0xfb58, 0x030e, 0x09d8,
+	0x0dfe, 0x0f70, 0x0f8a, 0x0fdc, 0x10fe, 0x125d, 0x12f9, 0x125d,
+	0x10eb, 0x0f62, 0x0e2a, 0x0d0e, 0x0b9e, 0x09b3, 0x079f, 0x05df,
+	0x04a3, 0x03b4, 0x02ba, 0x019c, 0x0092, 0xffe5, 0xff9d, 0xff7b,
+	0xff38, 0xfeca, 0xfe64, 0xfe3b, 0xfe4a, 0xfe5d, 0xfe46, 0xfe0b,
+	0xfde0, 0xfdf0, 0xfe2d, 0xfe67, 0xfe7f, 0xfe83, 0xfea1, 0xfef1,
+	0xff5e, 0xffb9, 0xffec, 0x000c, 0x003e, 0x0090, 0x00e9, 0x0122,
+	0x012e, 0x012a, 0x0137, 0x015e, 0x0181, 0x0183, 0x0161, 0x013a,
+	0x012e, 0x0139, 0x013f, 0x0128, 0x00f9, 0x00d1, 0x00c7, 0x00d2,
+	0x00d6, 0x00bd, 0x0095, 0x007b, 0x007f, 0x0091, 0x0096, 0x0081,
+	0x0061, 0x0054, 0x0062, 0x0077, 0x007a, 0x0065, 0x004b, 0x0045,
+	0x0057, 0x006a, 0x0069, 0x0051, 0x003a, 0x003b, 0x004e, 0x005e,
+	0x0056, 0x003d, 0x002b, 0x002f, 0x0043, 0x004e, 0x0040, 0x0027,
+	0x0019, 0x0022, 0x0036, 0x003c, 0x002a, 0x0011, 0x0008, 0x0015,
+	0x0028, 0x0028, 0x0014, 0xfffc, 0xfff8, 0x0009, 0x0019, 0x0014,
+	0xfffd, 0xffe9, 0xffea, 0xfffc, 0x0009, 0x0000, 0xffe7, 0xffd6,
+	0xffdc, 0xffef, 0xfff8, 0xffea, 0xffd0, 0xffc4, 0xffce, 0xffe1,
+	0xffe6, 0xffd3, 0xffbb, 0xffb3, 0xffc1, 0xffd4, 0xffd3, 0xffbd,
+	0xffa6, 0xffa4, 0xffb7, 0xffc7, 0xffc2, 0xffaa, 0xff95, 0xff98,
+	0xffae, 0xffbc, 0xffb1, 0xff96, 0xff85, 0xff8e, 0xffa4, 0xffac,
+	0xff98, 0xff79, 0xff69, 0xff73, 0xff84, 0xff82, 0xff62, 0xff3b,
+	0xff29, 0xff31, 0xff39, 0xff28, 0xfefc, 0xfed0, 0xfec1, 0xfecb,
+	0xfed2, 0xfebf, 0xfe96, 0xfe7a, 0xfe84, 0xfeac, 0xfece, 0xfed6,
+	0xfed2, 0xfee6, 0xff28, 0xff83, 0xffd1, 0xfffc, 0x001b, 0x0057,
+	0x00b9, 0x0124, 0x016a, 0x017f, 0x0183, 0x01a3, 0x01e2, 0x0219,
+	0x021b, 0x01e8, 0x01b1, 0x01a4, 0x01bb, 0x01c3, 0x018a, 0x011c,
+	0x00b5, 0x007d, 0x005a, 0xffff, 0xff3b, 0xfe26, 0xfd0d, 0xfc1a,
+	0xfb22, 0xf9cc, 0xf7f2, 0xf5dc, 0xf408, 0xf2b2, 0xf19a, 0xf050,
+	0xeebd, 0xed6a, 0xed0e, 0xede6, 0xef4e, 0xf047, 0xf075, 0xf0b4,
+	0xf2a6, 0xf76e, 0xfe9c, 0x0635, 0x0bfe, 0x0ee3, 0x0f8b, 0x0f95,
+	0x1042, 0x119d, 0x12c4, 0x12db, 0x11cd, 0x103b, 0x0ed2, 0x0db4,
+	0x0c7f, 0x0ad8, 0x08cc, 0x06d0, 0x0549, 0x0439, 0x034e, 0x0242,
+	0x0123, 0x003a, 0xffbc, 0xff8e, 0xff64, 0xff0d, 0xfe9a, 0xfe4a,
+	0xfe3d, 0xfe55, 0xfe59, 0xfe2e, 0xfdf4, 0xfddf, 0xfe07, 0xfe49,
+	0xfe76, 0xfe81, 0xfe8a, 0xfebd, 0xff1f, 0xff8a, 0xffd4, 0xfffa,
+	0x001d, 0x005e, 0x00b8, 0x0108, 0x012c, 0x012c, 0x012c, 0x0145,
+	0x016f, 0x0187, 0x0177, 0x014f, 0x0131, 0x0131, 0x013e, 0x0139,
+	0x0116, 0x00e5, 0x00c9, 0x00cb, 0x00d6, 0x00ce, 0x00ac, 0x0087,
+	0x0079, 0x0087, 0x0097, 0x0090, 0x0073, 0x0058, 0x0057, 0x006b,
+	0x007b, 0x0073, 0x0058, 0x0045, 0x004b, 0x0061, 0x006c, 0x0060,
+	0x0046, 0x0038, 0x0042, 0x0057, 0x005d, 0x004c, 0x0033, 0x0029,
+	0x0037, 0x004a, 0x004b, 0x0036, 0x001e, 0x001a, 0x002a, 0x003b,
+	0x0037, 0x001f, 0x000b, 0x000c, 0x001d, 0x002b, 0x0022, 0x0009,
+	0xfff8, 0xfffe, 0x0011, 0x001a, 0x000b, 0xfff3, 0xffe6, 0xfff1,
+	0x0004, 0x0008, 0xfff6, 0xffdd, 0xffd6, 0xffe4, 0xfff5, 0xfff4,
+	0xffdf, 0xffc8, 0xffc6, 0xffd7, 0xffe7, 0xffe1, 0xffc8, 0xffb4,
+	0xffb7, 0xffcb, 0xffd7, 0xffcc, 0xffb2, 0xffa2, 0xffaa, 0xffc0,
+	0xffc9, 0xffb8, 0xff9e, 0xff93, 0xffa0, 0xffb6, 0xffbb, 0xffa6,
+	0xff8b, 0xff85, 0xff97, 0xffaa, 0xffa6, 0xff8a, 0xff6f, 0xff6a,
+	0xff7b, 0xff87, 0xff77, 0xff51, 0xff30, 0xff2a, 0xff36, 0xff36,
+	0xff18, 0xfee8, 0xfec5, 0xfec3, 0xfed0, 0xfecd, 0xfeae, 0xfe87,
+	0xfe7a, 0xfe94, 0xfebd, 0xfed4, 0xfed3, 0xfed6, 0xfefd, 0xff4e,
+	0xffa8, 0xffe6, 0x0008, 0x0030, 0x007e, 0x00e9, 0x0148, 0x0177,
+	0x0180, 0x018c, 0x01bb, 0x01fe, 0x0221, 0x0209, 0x01ce, 0x01a5,
+};
+
+/* Voiced speech at 44.1 kHz, resampled from the one at 48 kHz, a 20ms sample */
+static uint16_t ex_slin44[] = {
+	0x01a8, 0x01bb, 0x01c5, 0x01b2, 0x0179, 0x012a, 0x00d7, 0x009c,
+	0x007d, 0x005d, 0x0042, 0xffc6, 0xff62, 0xfe45, 0xfe42, 0xff8f,
+	0xff31, 0xfee5, 0xfe9d, 0xfe50, 0xfe42, 0xfe3d, 0xfe57, 0xfe5c,
+	0xfe4e, 0xfe26, 0xfdfb, 0xfde1, 0xfde5, 0xfe08, 0xfe38, 0xfe63,
+	0xfe7a, 0xfe80, 0xfe84, 0xfe98, 0xfec6, 0xff0c, 0xff5c, 0xffa2,
+	0xffd4, 0xfff1, 0x0008, 0x0026, 0x0056, 0x0096, 0x00d8, 0x010c,
+	0x0128, 0x012e, 0x012b, 0x012c, 0x013c, 0x0158, 0x0175, 0x0185,
+	0x0182, 0x016b, 0x014c, 0x0135, 0x012d, 0x0134, 0x013e, 0x013e,
+	0x012e, 0x010e, 0x00eb, 0x00d0, 0x00c7, 0x00cc, 0x00d4, 0x00d6,
+	0x00c9, 0x00af, 0x0092, 0x007e, 0x007a, 0x0083, 0x0091, 0x0097,
+	0x008f, 0x007b, 0x0064, 0x0056, 0x0056, 0x0063, 0x0074, 0x007c,
+	0x0076, 0x0064, 0x0051, 0x0045, 0x0047, 0x0054, 0x0064, 0x006d,
+	0x0068, 0x0057, 0x0044, 0x0038, 0x003a, 0x0047, 0x0057, 0x005e,
+	0x0058, 0x0048, 0x0035, 0x002a, 0x002c, 0x0039, 0x0047, 0x004e,
+	0x0047, 0x0037, 0x0024, 0x0019, 0x001c, 0x0028, 0x0036, 0x003c,
+	0x0036, 0x0025, 0x0013, 0x0008, 0x000b, 0x0018, 0x0026, 0x002b,
+	0x0024, 0x0013, 0x0001, 0xfff7, 0xfffa, 0x0007, 0x0015, 0x001a,
+	0x0013, 0x0002, 0xfff0, 0xffe7, 0xffea, 0xfff6, 0x0003, 0x0009,
+	0x0002, 0xfff0, 0xffdf, 0xffd5, 0xffd9, 0xffe5, 0xfff3, 0xfff8,
+	0xfff0, 0xffdf, 0xffcd, 0xffc4, 0xffc8, 0xffd5, 0xffe3, 0xffe7,
+	0xffdf, 0xffce, 0xffbb, 0xffb2, 0xffb7, 0xffc4, 0xffd2, 0xffd7,
+	0xffce, 0xffbc, 0xffaa, 0xffa2, 0xffa7, 0xffb5, 0xffc3, 0xffc9,
+	0xffc0, 0xffad, 0xff9b, 0xff93, 0xff99, 0xffa8, 0xffb7, 0xffbc,
+	0xffb3, 0xffa0, 0xff8d, 0xff84, 0xff8a, 0xff9a, 0xffa8, 0xffac,
+	0xffa0, 0xff8a, 0xff74, 0xff69, 0xff6c, 0xff7a, 0xff85, 0xff85,
+	0xff73, 0xff58, 0xff3c, 0xff2b, 0xff2a, 0xff32, 0xff39, 0xff33,
+	0xff1c, 0xfef9, 0xfed8, 0xfec4, 0xfec1, 0xfecb, 0xfed2, 0xfece,
+	0xfeb9, 0xfe9c, 0xfe83, 0xfe79, 0xfe86, 0xfea2, 0xfebf, 0xfed2,
+	0xfed6, 0xfed2, 0xfed5, 0xfeed, 0xff1c, 0xff5c, 0xff9e, 0xffd1,
+	0xfff3, 0x000a, 0x0025, 0x0052, 0x0094, 0x00e3, 0x012d, 0x0161,
+	0x017a, 0x0180, 0x0183, 0x0197, 0x01be, 0x01ee, 0x0216, 0x0221,
+	0x020d, 0x01e3, 0x01b9, 0x01a3, 0x01a8, 0x01bb, 0x01c5, 0x01b2,
+	0x017a, 0x0129, 0x00d8, 0x009c, 0x007b, 0x0063, 0x0036, 0xffd9,
+	0xff41, 0xfe7d, 0xfdaa, 0xfce6, 0xfc37, 0xfb8c, 0xfac1, 0xf9b6,
+	0xf865, 0xf6e5, 0xf568, 0xf41b, 0xf313, 0xf23f, 0xf173, 0xf084,
+	0xef69, 0xee45, 0xed62, 0xed07, 0xed56, 0xee2f, 0xef38, 0xf00b,
+	0xf06c, 0xf074, 0xf097, 0xf17c, 0xf3ba, 0xf787, 0xfc9b, 0x023f,
+	0x0783, 0x0b9f, 0x0e2d, 0x0f4f, 0x0f8c, 0x0f8d, 0x0fd7, 0x1096,
+	0x119c, 0x1287, 0x12f7, 0x12be, 0x11f2, 0x10d5, 0x0fb3, 0x0ebb,
+	0x0dea, 0x0d1c, 0x0c21, 0x0ae2, 0x096b, 0x07e8, 0x068a, 0x0570,
+	0x049a, 0x03eb, 0x0340, 0x0280, 0x01ae, 0x00e4, 0x0041, 0xffd8,
+	0xffa4, 0xff8a, 0xff6d, 0xff36, 0xfee8, 0xfe96, 0xfe57, 0xfe3c,
+	0xfe41, 0xfe54, 0xfe5d, 0xfe4e, 0xfe27, 0xfdfb, 0xfde0, 0xfde5,
+	0xfe08, 0xfe38, 0xfe63, 0xfe7a, 0xfe80, 0xfe84, 0xfe97, 0xfec6,
+	0xff0c, 0xff5c, 0xffa2, 0xffd4, 0xfff1, 0x0008, 0x0026, 0x0056,
+	0x0096, 0x00d8, 0x010c, 0x0128, 0x012e, 0x012b, 0x012c, 0x013b,
+	0x0158, 0x0176, 0x0186, 0x0182, 0x016b, 0x014c, 0x0135, 0x012e,
+	0x0134, 0x013e, 0x013e, 0x012e, 0x010e, 0x00eb, 0x00d0, 0x00c7,
+	0x00cc, 0x00d4, 0x00d6, 0x00c9, 0x00af, 0x0092, 0x007e, 0x007a,
+	0x0083, 0x0092, 0x0097, 0x008f, 0x007b, 0x0064, 0x0056, 0x0057,
+	0x0063, 0x0073, 0x007c, 0x0076, 0x0065, 0x0051, 0x0044, 0x0047,
+	0x0054, 0x0064, 0x006d, 0x0068, 0x0056, 0x0043, 0x0038, 0x003a,
+	0x0048, 0x0057, 0x005e, 0x0058, 0x0048, 0x0035, 0x002a, 0x002c,
+	0x0039, 0x0047, 0x004e, 0x0047, 0x0037, 0x0024, 0x001a, 0x001c,
+	0x0028, 0x0037, 0x003d, 0x0035, 0x0025, 0x0013, 0x0008, 0x000b,
+	0x0018, 0x0025, 0x002b, 0x0024, 0x0013, 0x0002, 0xfff7, 0xfffa,
+	0x0007, 0x0014, 0x001a, 0x0013, 0x0002, 0xfff0, 0xffe6, 0xffea,
+	0xfff6, 0x0004, 0x0009, 0x0001, 0xfff1, 0xffdf, 0xffd5, 0xffd8,
+	0xffe6, 0xfff3, 0xfff8, 0xfff1, 0xffdf, 0xffcd, 0xffc4, 0xffc8,
+	0xffd4, 0xffe2, 0xffe7, 0xffdf, 0xffcd, 0xffbb, 0xffb3, 0xffb7,
+	0xffc4, 0xffd3, 0xffd7, 0xffce, 0xffbc, 0xffaa, 0xffa2, 0xffa7,
+	0xffb5, 0xffc4, 0xffc8, 0xffc0, 0xffae, 0xff9c, 0xff93, 0xff98,
+	0xffa8, 0xffb7, 0xffbc, 0xffb3, 0xffa0, 0xff8c, 0xff85, 0xff8a,
+	0xff9a, 0xffa8, 0xffab, 0xffa0, 0xff8a, 0xff74, 0xff69, 0xff6d,
+	0xff7a, 0xff85, 0xff85, 0xff74, 0xff58, 0xff3c, 0xff2b, 0xff2b,
+	0xff33, 0xff39, 0xff33, 0xff1b, 0xfefa, 0xfed8, 0xfec4, 0xfec2,
+	0xfeca, 0xfed2, 0xfece, 0xfeba, 0xfe9c, 0xfe82, 0xfe79, 0xfe85,
+	0xfea2, 0xfec0, 0xfed2, 0xfed6, 0xfed2, 0xfed5, 0xfeec, 0xff1b,
+	0xff5c, 0xff9e, 0xffd2, 0xfff4, 0x000a, 0x0024, 0x0051, 0x0094,
+	0x00e4, 0x012e, 0x0162, 0x017a, 0x017f, 0x0184, 0x0196, 0x01be,
+	0x01ef, 0x0215, 0x0221, 0x020d, 0x01e3, 0x01b9, 0x01a3, 0x01a8,
+	0x01bb, 0x01c6, 0x01b2, 0x017a, 0x0129, 0x00d8, 0x009c, 0x007b,
+	0x0063, 0x0036, 0xffd9, 0xff42, 0xfe7e, 0xfdab, 0xfce6, 0xfc37,
+	0xfb8c, 0xfac1, 0xf9b6, 0xf865, 0xf6e5, 0xf567, 0xf41b, 0xf313,
+	0xf240, 0xf173, 0xf085, 0xef69, 0xee45, 0xed62, 0xed07, 0xed56,
+	0xee2e, 0xef37, 0xf00b, 0xf06c, 0xf074, 0xf097, 0xf17d, 0xf3b9,
+	0xf786, 0xfc9b, 0x023e, 0x0784, 0x0b9f, 0x0e2e, 0x0f4f, 0x0f8c,
+	0x0f8d, 0x0fd7, 0x1096, 0x119b, 0x1287, 0x12f7, 0x12be, 0x11f2,
+	0x10d4, 0x0fb2, 0x0eba, 0x0dea, 0x0d1b, 0x0c21, 0x0ae2, 0x096b,
+	0x07e8, 0x068a, 0x0571, 0x049b, 0x03ec, 0x0340, 0x0280, 0x01ae,
+	0x00e4, 0x0041, 0xffd8, 0xffa4, 0xff8a, 0xff6c, 0xff37, 0xfee9,
+	0xfe95, 0xfe57, 0xfe3c, 0xfe41, 0xfe54, 0xfe5d, 0xfe4d, 0xfe27,
+	0xfdfb, 0xfde1, 0xfde5, 0xfe08, 0xfe39, 0xfe63, 0xfe7a, 0xfe80,
+	0xfe84, 0xfe97, 0xfec5, 0xff0c, 0xff5c, 0xffa3, 0xffd5, 0xfff2,
+	0x0008, 0x0026, 0x0056, 0x0096, 0x00d8, 0x010c, 0x0128, 0x012e,
+	0x012b, 0x012c, 0x013b, 0x0158, 0x0175, 0x0186, 0x0182, 0x016a,
+	0x014c, 0x0135, 0x012d, 0x0134, 0x013d, 0x013e, 0x012d, 0x010f,
+	0x00eb, 0x00d0, 0x00c7, 0x00cb, 0x00d4, 0x00d6, 0x00c8, 0x00ae,
+	0x0092, 0x007e, 0x007a, 0x0084, 0x0091, 0x0098, 0x008f, 0x007b,
+	0x0064, 0x0056, 0x0056, 0x0063, 0x0073, 0x007b, 0x0076, 0x0065,
+	0x0051, 0x0045, 0x0047, 0x0054, 0x0064, 0x006c, 0x0067, 0x0057,
+	0x0044, 0x0039, 0x003b, 0x0048, 0x0057, 0x005e, 0x0058, 0x0048,
+	0x0035, 0x002a, 0x002c, 0x0039, 0x0047, 0x004e, 0x0047, 0x0037,
+	0x0024, 0x0019, 0x001c, 0x0028, 0x0036, 0x003c, 0x0036, 0x0025,
+	0x0013, 0x0009, 0x000b, 0x0017, 0x0025, 0x002b, 0x0025, 0x0014,
+	0x0002, 0xfff7, 0xfffb, 0x0007, 0x0014, 0x001a, 0x0012, 0x0002,
+	0xfff0, 0xffe7, 0xffea, 0xfff6, 0x0004, 0x0009, 0x0001, 0xfff1,
+	0xffdf, 0xffd5, 0xffd9, 0xffe6, 0xfff3, 0xfff8, 0xfff0, 0xffdf,
+	0xffcd, 0xffc4, 0xffc8, 0xffd5, 0xffe2, 0xffe8, 0xffdf, 0xffce,
+	0xffbb, 0xffb3, 0xffb7, 0xffc4, 0xffd2, 0xffd6, 0xffce, 0xffbc,
+	0xffaa, 0xffa2, 0xffa6, 0xffb5, 0xffc4, 0xffc9, 0xffc0, 0xffad,
+	0xff9b, 0xff94, 0xff99, 0xffa8, 0xffb7, 0xffbc, 0xffb3, 0xffa0,
+	0xff8d, 0xff84, 0xff8a, 0xff9a, 0xffa8, 0xffab, 0xffa0, 0xff8a,
+	0xff74, 0xff69, 0xff6d, 0xff7a, 0xff85, 0xff84, 0xff74, 0xff58,
+	0xff3c, 0xff2b, 0xff2a, 0xff33, 0xff39, 0xff33, 0xff1c, 0xfef9,
+	0xfed8, 0xfec4, 0xfec1, 0xfeca, 0xfed2, 0xfece, 0xfeba, 0xfe9c,
+	0xfe82, 0xfe79, 0xfe86, 0xfea2, 0xfebf, 0xfed2, 0xfed6, 0xfed2,
+	0xfed5, 0xfeec, 0xff1c, 0xff5c, 0xff9d, 0xffd2, 0xfff3, 0x000a,
+	0x0025, 0x0052, 0x0095, 0x00e4, 0x012d, 0x0161, 0x017a, 0x017f,
+	0x0184, 0x0196, 0x01bd, 0x01ee, 0x0215, 0x0221, 0x020c, 0x01e3,
+	0x01b9, 0x01a3,
+};
+
+/* Voiced speech at 48 kHz, a 20ms sample */
+static uint16_t ex_slin48[] = {
+	0xff78, 0xff4f, 0xff0f, 0xfec2, 0xfe7b, 0xfe4b, 0xfe3b, 0xfe43,
+	0xfe55, 0xfe5e, 0xfe51, 0xfe2f, 0xfe06, 0xfde7, 0xfddf, 0xfdf3,
+	0xfe1b, 0xfe47, 0xfe6a, 0xfe7c, 0xfe80, 0xfe84, 0xfe95, 0xfebc,
+	0xfef9, 0xff41, 0xff87, 0xffbe, 0xffe2, 0xfff9, 0x000e, 0x002d,
+	0x005c, 0x0097, 0x00d4, 0x0106, 0x0124, 0x012e, 0x012c, 0x012a,
+	0x0131, 0x0145, 0x0161, 0x017a, 0x0186, 0x0181, 0x016c, 0x0150,
+	0x0139, 0x012e, 0x0130, 0x013a, 0x0140, 0x013a, 0x0125, 0x0106,
+	0x00e6, 0x00cf, 0x00c7, 0x00cb, 0x00d3, 0x00d7, 0x00cf, 0x00bb,
+	0x00a0, 0x0088, 0x007b, 0x007b, 0x0086, 0x0092, 0x0097, 0x0090,
+	0x007f, 0x0069, 0x0059, 0x0054, 0x005c, 0x006b, 0x0078, 0x007c,
+	0x0073, 0x0062, 0x0050, 0x0045, 0x0046, 0x0051, 0x0060, 0x006b,
+	0x006c, 0x0061, 0x004f, 0x003f, 0x0037, 0x003c, 0x0048, 0x0057,
+	0x005e, 0x005a, 0x004d, 0x003b, 0x002d, 0x0029, 0x0030, 0x003e,
+	0x004a, 0x004e, 0x0046, 0x0037, 0x0025, 0x001a, 0x001a, 0x0023,
+	0x0031, 0x003b, 0x003b, 0x0031, 0x0020, 0x0010, 0x0008, 0x000b,
+	0x0017, 0x0024, 0x002b, 0x0027, 0x001a, 0x0009, 0xfffb, 0xfff7,
+	0xfffd, 0x000a, 0x0016, 0x001a, 0x0013, 0x0004, 0xfff3, 0xffe8,
+	0xffe7, 0xfff0, 0xfffd, 0x0007, 0x0008, 0xfffe, 0xffed, 0xffde,
+	0xffd5, 0xffd8, 0xffe3, 0xfff0, 0xfff8, 0xfff5, 0xffe8, 0xffd7,
+	0xffc9, 0xffc4, 0xffca, 0xffd6, 0xffe3, 0xffe7, 0xffe1, 0xffd2,
+	0xffc0, 0xffb4, 0xffb3, 0xffbc, 0xffca, 0xffd5, 0xffd6, 0xffcc,
+	0xffbb, 0xffab, 0xffa2, 0xffa5, 0xffb1, 0xffbf, 0xffc8, 0xffc6,
+	0xffb9, 0xffa7, 0xff98, 0xff93, 0xff9a, 0xffa8, 0xffb6, 0xffbc,
+	0xffb6, 0xffa7, 0xff94, 0xff87, 0xff85, 0xff8f, 0xff9e, 0xffaa,
+	0xffab, 0xffa0, 0xff8b, 0xff77, 0xff6a, 0xff6a, 0xff74, 0xff81,
+	0xff87, 0xff80, 0xff6c, 0xff52, 0xff39, 0xff2b, 0xff2a, 0xff31,
+	0xff39, 0xff36, 0xff26, 0xff09, 0xfee9, 0xfece, 0xfec1, 0xfec3,
+	0xfecc, 0xfed2, 0xfece, 0xfebc, 0xfea1, 0xfe88, 0xfe7a, 0xfe7e,
+	0xfe93, 0xfeaf, 0xfec7, 0xfed4, 0xfed6, 0xfed2, 0xfed5, 0xfeea,
+	0xff13, 0xff4c, 0xff8a, 0xffbf, 0xffe5, 0xfffe, 0x0012, 0x002f,
+	0x005d, 0x009d, 0x00e6, 0x012a, 0x015c, 0x0177, 0x017f, 0x0181,
+	0x018b, 0x01a7, 0x01d0, 0x01fc, 0x021b, 0x0220, 0x020b, 0x01e4,
+	0x01bd, 0x01a5, 0x01a5, 0x01b4, 0x01c4, 0x01c0, 0x019f, 0x0161,
+	0x0114, 0x00cc, 0x0098, 0x007b, 0x0065, 0x0040, 0xfff5, 0xff78,
+	0xfed0, 0xfe10, 0xfd52, 0xfca6, 0xfc09, 0xfb69, 0xfaa7, 0xf9ae,
+	0xf878, 0xf71a, 0xf5b7, 0xf477, 0xf36f, 0xf29d, 0xf1e3, 0xf11e,
+	0xf034, 0xef29, 0xee21, 0xed59, 0xed07, 0xed45, 0xedfe, 0xeef1,
+	0xefcc, 0xf051, 0xf076, 0xf076, 0xf0c3, 0xf1e3, 0xf43a, 0xf7e2,
+	0xfc97, 0x01c5, 0x06b4, 0x0abe, 0x0d83, 0x0efd, 0x0f80, 0x0f8b,
+	0x0f9a, 0x0fff, 0x10c3, 0x11b7, 0x128b, 0x12f5, 0x12d0, 0x1229,
+	0x112f, 0x101f, 0x0f28, 0x0e59, 0x0da0, 0x0cd9, 0x0be4, 0x0ab5,
+	0x0959, 0x07f5, 0x06af, 0x05a2, 0x04d0, 0x0428, 0x038d, 0x02e7,
+	0x022e, 0x016c, 0x00b9, 0x002d, 0xffd3, 0xffa4, 0xff8c, 0xff73,
+	0xff47, 0xff04, 0xfeb7, 0xfe72, 0xfe47, 0xfe3b, 0xfe46, 0xfe57,
+	0xfe5d, 0xfe4d, 0xfe2a, 0xfe01, 0xfde4, 0xfde0, 0xfdf8, 0xfe21,
+	0xfe4d, 0xfe6e, 0xfe7d, 0xfe81, 0xfe85, 0xfe99, 0xfec3, 0xff03,
+	0xff4c, 0xff90, 0xffc5, 0xffe6, 0xfffc, 0x0012, 0x0033, 0x0064,
+	0x00a0, 0x00dc, 0x010b, 0x0127, 0x012e, 0x012c, 0x012a, 0x0133,
+	0x0148, 0x0165, 0x017d, 0x0187, 0x017f, 0x0168, 0x014c, 0x0136,
+	0x012e, 0x0132, 0x013b, 0x0140, 0x0138, 0x0121, 0x0101, 0x00e2,
+	0x00cd, 0x00c7, 0x00cc, 0x00d4, 0x00d7, 0x00cd, 0x00b7, 0x009c,
+	0x0085, 0x007a, 0x007c, 0x0088, 0x0094, 0x0097, 0x008e, 0x007c,
+	0x0066, 0x0057, 0x0055, 0x005e, 0x006d, 0x0079, 0x007b, 0x0071,
+	0x0060, 0x004e, 0x0044, 0x0047, 0x0053, 0x0062, 0x006c, 0x006b,
+	0x005e, 0x004c, 0x003d, 0x0037, 0x003d, 0x004b, 0x0058, 0x005e,
+	0x0059, 0x004a, 0x0039, 0x002c, 0x002a, 0x0032, 0x0040, 0x004b,
+	0x004d, 0x0044, 0x0034, 0x0023, 0x001a, 0x001b, 0x0025, 0x0033,
+	0x003c, 0x003a, 0x002e, 0x001d, 0x000e, 0x0008, 0x000c, 0x0019,
+	0x0025, 0x002b, 0x0026, 0x0018, 0x0007, 0xfffa, 0xfff7, 0xffff,
+	0x000c, 0x0017, 0x001a, 0x0011, 0x0002, 0xfff1, 0xffe7, 0xffe8,
+	0xfff2, 0xffff, 0x0008, 0x0007, 0xfffc, 0xffeb, 0xffdc, 0xffd5,
+	0xffd9, 0xffe5, 0xfff2, 0xfff8, 0xfff4, 0xffe6, 0xffd4, 0xffc7,
+	0xffc4, 0xffcb, 0xffd8, 0xffe4, 0xffe7, 0xffdf, 0xffcf, 0xffbe,
+	0xffb4, 0xffb4, 0xffbe, 0xffcc, 0xffd6, 0xffd5, 0xffca, 0xffb9,
+	0xffa9, 0xffa2, 0xffa6, 0xffb3, 0xffc1, 0xffc8, 0xffc5, 0xffb7,
+	0xffa5, 0xff97, 0xff93, 0xff9b, 0xffaa, 0xffb8, 0xffbc, 0xffb5,
+	0xffa4, 0xff91, 0xff86, 0xff86, 0xff91, 0xffa0, 0xffab, 0xffaa,
+	0xff9d, 0xff88, 0xff74, 0xff6a, 0xff6b, 0xff76, 0xff82, 0xff87,
+	0xff7e, 0xff69, 0xff4e, 0xff36, 0xff2a, 0xff2b, 0xff33, 0xff39,
+	0xff35, 0xff22, 0xff05, 0xfee4, 0xfecb, 0xfec1, 0xfec4, 0xfecd,
+	0xfed3, 0xfecc, 0xfeb9, 0xfe9d, 0xfe85, 0xfe79, 0xfe80, 0xfe96,
+	0xfeb3, 0xfeca, 0xfed5, 0xfed5, 0xfed2, 0xfed7, 0xfeee, 0xff1a,
+	0xff55, 0xff92, 0xffc6, 0xffea, 0x0001, 0x0015, 0x0034, 0x0065,
+	0x00a7, 0x00f1, 0x0133, 0x0162, 0x0179, 0x017f, 0x0182, 0x018e,
+	0x01ac, 0x01d7, 0x0202, 0x021d, 0x021f, 0x0206, 0x01de, 0x01b8,
+	0x01a4, 0x01a6, 0x01b7, 0x01c5, 0x01be, 0x0198, 0x0156, 0x0109,
+	0x00c3, 0x0093, 0x0078, 0x0061, 0x0038, 0xffe6, 0xff63, 0xfeb6,
+	0xfdf5, 0xfd39, 0xfc8f, 0xfbf3, 0xfb50, 0xfa87, 0xf985, 0xf848,
+	0xf6e6, 0xf586, 0xf44d, 0xf34e, 0xf282, 0xf1c9, 0xf100, 0xf010,
+	0xef01, 0xedff, 0xed45, 0xed07, 0xed59, 0xee1f, 0xef13, 0xefe5,
+	0xf05b, 0xf076, 0xf079, 0xf0dd, 0xf224, 0xf4ab, 0xf880, 0xfd51,
+	0x0282, 0x0759, 0x0b39, 0x0dcc, 0x0f1d, 0x0f86, 0x0f8a, 0x0fa2,
+	0x1015, 0x10e5, 0x11d9, 0x12a2, 0x12f8, 0x12c0, 0x1209, 0x1108,
+	0x0ff9, 0x0f08, 0x0e3e, 0x0d85, 0x0cb9, 0x0bbc, 0x0a85, 0x0926,
+	0x07c4, 0x0685, 0x0581, 0x04b7, 0x0412, 0x0377, 0x02ce, 0x0212,
+	0x0151, 0x00a3, 0x001d, 0xffca, 0xffa0, 0xff89, 0xff6e, 0xff3f,
+	0xfefa, 0xfeac, 0xfe6a, 0xfe43, 0xfe3b, 0xfe48, 0xfe59, 0xfe5c,
+	0xfe49, 0xfe24, 0xfdfc, 0xfde2, 0xfde2, 0xfdfd, 0xfe28, 0xfe53,
+	0xfe71, 0xfe7e, 0xfe81, 0xfe87, 0xfe9d, 0xfecb, 0xff0d, 0xff56,
+	0xff99, 0xffcb, 0xffea, 0xffff, 0x0016, 0x0039, 0x006c, 0x00a9,
+	0x00e4, 0x0111, 0x0129, 0x012e, 0x012b, 0x012b, 0x0135, 0x014c,
+	0x0169, 0x017f, 0x0187, 0x017c, 0x0164, 0x0148, 0x0134, 0x012d,
+	0x0133, 0x013c, 0x013f, 0x0135, 0x011d, 0x00fd, 0x00de, 0x00cb,
+	0x00c7, 0x00cd, 0x00d5, 0x00d6, 0x00ca, 0x00b3, 0x0098, 0x0083,
+	0x0079, 0x007e, 0x008a, 0x0095, 0x0097, 0x008c, 0x0078, 0x0064,
+	0x0056, 0x0055, 0x0060, 0x006f, 0x007a, 0x007a, 0x006f, 0x005d,
+	0x004c, 0x0044, 0x0048, 0x0055, 0x0064, 0x006c, 0x0069, 0x005c,
+	0x004a, 0x003c, 0x0038, 0x003f, 0x004d, 0x005a, 0x005e, 0x0057,
+	0x0048, 0x0036, 0x002b, 0x002a, 0x0034, 0x0042, 0x004c, 0x004d,
+	0x0042, 0x0032, 0x0021, 0x0019, 0x001c, 0x0027, 0x0034, 0x003c,
+	0x0039, 0x002c, 0x001b, 0x000d, 0x0008, 0x000e, 0x001a, 0x0026,
+	0x002b, 0x0025, 0x0016, 0x0005, 0xfff9, 0xfff8, 0x0001, 0x000e,
+	0x0018, 0x0019, 0x000f, 0xffff, 0xffef, 0xffe7, 0xffe9, 0xfff4,
+	0x0001, 0x0009, 0x0006, 0xfffa, 0xffe9, 0xffda, 0xffd5, 0xffdb,
+	0xffe7, 0xfff3, 0xfff8, 0xfff2, 0xffe3, 0xffd2, 0xffc6, 0xffc4,
+	0xffcd, 0xffda, 0xffe5, 0xffe7, 0xffdd, 0xffcd, 0xffbc, 0xffb3,
+	0xffb5, 0xffc0, 0xffce, 0xffd6, 0xffd4, 0xffc8, 0xffb6, 0xffa7,
+	0xffa2, 0xffa7, 0xffb5, 0xffc3, 0xffc9, 0xffc3, 0xffb4, 0xffa2,
+	0xff96, 0xff94, 0xff9d, 0xffac, 0xffb9, 0xffbc, 0xffb3, 0xffa1,
+	0xff8f, 0xff85, 0xff87, 0xff93, 0xffa2, 0xffab, 0xffa9, 0xff9a,
+	0xff85, 0xff72, 0xff69, 0xff6c, 0xff78, 0xff83, 0xff86, 0xff7c,
+	0xff65, 0xff4a, 0xff34, 0xff29, 0xff2b, 0xff34, 0xff39, 0xff33,
+	0xff1f, 0xff00, 0xfee0, 0xfec9, 0xfec0, 0xfec5, 0xfece, 0xfed2,
+	0xfeca, 0xfeb5, 0xfe99, 0xfe82, 0xfe79, 0xfe83, 0xfe9a, 0xfeb7,
+	0xfecc, 0xfed6, 0xfed4, 0xfed2, 0xfed9, 0xfef3, 0xff22, 0xff5e,
+	0xff9a, 0xffcc, 0xffed, 0x0003, 0x0019, 0x003a, 0x006e, 0x00b2,
+	0x00fb, 0x013b, 0x0166, 0x017b, 0x017f, 0x0183, 0x0191, 0x01b1,
+	0x01dd, 0x0207, 0x021f, 0x021d, 0x0200, 0x01d8, 0x01b4, 0x01a3,
+	0x01a8, 0x01b9, 0x01c5, 0x01ba, 0x0190, 0x014c, 0x00fe, 0x00bb,
+	0x008e, 0x0075, 0x005d, 0x0030, 0xffd7, 0xff4c, 0xfe9b, 0xfdd9,
+};
+
+static struct ast_frame *slin12_sample(void)
+{
+	static struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = sizeof(ex_slin12),
+		.samples = ARRAY_LEN(ex_slin12),
+		.mallocd = 0,
+		.offset = 0,
+		.src = __PRETTY_FUNCTION__,
+		.data.ptr = ex_slin12,
+	};
+
+	f.subclass.format = ast_format_slin12;
+
+	return &f;
+}
+
+static struct ast_frame *slin24_sample(void)
+{
+	static struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = sizeof(ex_slin24),
+		.samples = ARRAY_LEN(ex_slin24),
+		.mallocd = 0,
+		.offset = 0,
+		.src = __PRETTY_FUNCTION__,
+		.data.ptr = ex_slin24,
+	};
+
+	f.subclass.format = ast_format_slin24;
+
+	return &f;
+}
+
+static struct ast_frame *slin32_sample(void)
+{
+	static struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = sizeof(ex_slin32),
+		.samples = ARRAY_LEN(ex_slin32),
+		.mallocd = 0,
+		.offset = 0,
+		.src = __PRETTY_FUNCTION__,
+		.data.ptr = ex_slin32,
+	};
+
+	f.subclass.format = ast_format_slin32;
+
+	return &f;
+}
+
+static struct ast_frame *slin44_sample(void)
+{
+	static struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = sizeof(ex_slin44),
+		.samples = ARRAY_LEN(ex_slin44),
+		.mallocd = 0,
+		.offset = 0,
+		.src = __PRETTY_FUNCTION__,
+		.data.ptr = ex_slin44,
+	};
+
+	f.subclass.format = ast_format_slin44;
+
+	return &f;
+}
+
+static struct ast_frame *slin48_sample(void)
+{
+	static struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = sizeof(ex_slin48),
+		.samples = ARRAY_LEN(ex_slin48),
+		.mallocd = 0,
+		.offset = 0,
+		.src = __PRETTY_FUNCTION__,
+		.data.ptr = ex_slin48,
+	};
+
+	f.subclass.format = ast_format_slin48;
+
+	return &f;
+}
@@ -0,0 +1,887 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Playout buffer, FEC, and PLC in front of the Opus decoder
+ *
+ * Shared by codec_opus_open_source.c and utils/opus_replay.c; captures are
+ * replayed through the very code which runs in Asterisk. The includer
+ * provides ast_frame, ast_trans_pvt, ast_test_flag, ast_log, ast_debug,
+ * AST_LIN2MU, AST_LIN2A, ARRAY_LEN, MIN, and MAX.
+ */
+
+#ifndef _CODEC_OPUS_DECODE_H
+#define _CODEC_OPUS_DECODE_H
+
+#include <stdlib.h>                     /* for abs */
+#include <string.h>                     /* for memcpy */
+#include <time.h>                       /* for clock_gettime */
+
+#include <opus/opus.h>
+
+#include "opus_resample.h"
+
+/*
+ * Static tracepoints (USDT) of the provider codec_opus, see contrib/bpftrace.
+ * When not traced, a probe is a single nop; the arguments are in registers
+ * or on the stack anyway. Without sys/sdt.h, probes are gone completely.
+ */
+#if defined(HAVE_SYS_SDT_H)
+#include <sys/sdt.h>
+#define	OPUS_PROBE(name, ...)	STAP_PROBEV(codec_opus, name, __VA_ARGS__)
+#else
+#define	OPUS_PROBE(name, ...)
+#endif
+
+#define	BUFFER_SAMPLES	5760
+#define	MAX_CHANNELS	2
+
+/* Playout buffer in front of the decoder */
+#define	PLAYOUT_SLOTS	8	/* power of two */
+#define	PLAYOUT_MASK	(PLAYOUT_SLOTS - 1)
+#define	PLAYOUT_MAX_DEPTH	3
+#define	PLAYOUT_CALM_SLOTS	250	/* 5 seconds without late packets */
+#define	PLAYOUT_PACKET_SIZE	1500	/* RTP packets do not get larger */
+/* Lost slots reported at once, see the patch: the largest decoder buffer */
+/* over the samples of the shortest packet, 2.5 ms at 48 kHz */
+#define	PLAYOUT_MAX_BATCH	(BUFFER_SAMPLES * 2 / 120)
+
+/* Concealment of lost packets */
+#define	PLC_MAX_SLOTS	5	/* afterwards comfort noise */
+#define	COMFORT_NOISE_SAMPLES	1024
+
+/* Concealment tiers under a CPU budget, see opus_plc_tier() */
+#define	PLC_STRONG_COMPLEXITY	5	/* enables the deep PLC of libopus 1.5 */
+
+enum opus_plc_tier {
+	PLC_TIER_NOISE = 0,	/* comfort noise only, no decoder call */
+	PLC_TIER_CLASSIC,	/* PLC of libopus */
+	PLC_TIER_STRONG,	/* deep PLC of libopus, where built with it */
+};
+
+/*
+ * Shared by all decoders: the CPU which PLC may take is cpu_percent of one
+ * core. It accrues as tokens, up to one second worth, and each PLC call
+ * pays for its time. slot_ns estimates the costs per slot and tier.
+ */
+static struct opus_plc_budget {
+	int tier;		/* the best tier to use */
+	int cpu_percent;	/* 0 = unlimited */
+	long long tokens;	/* ns of CPU left */
+	long long refilled_ns;
+	int slot_ns[PLC_TIER_STRONG + 1];
+} plc_budget = { .tier = PLC_TIER_CLASSIC, };
+
+/* Activity of the sender, estimated from the packets */
+#define	ACTIVITY_HANGOVER	10	/* silent packets before decoding may stop */
+#define	CELT_SILENCE_BYTES	2	/* CELT spends not more on a silent frame */
+
+static int16_t comfort_noise[COMFORT_NOISE_SAMPLES];
+
+/* Private structures */
+struct opus_playout_slot {
+	int seqno;
+	int datalen; /* 0 = empty */
+	unsigned char data[PLAYOUT_PACKET_SIZE];
+};
+
+struct opus_playout {
+	int started;
+	int next;	/* sequence number of the slot to play out next */
+	int highest;	/* highest sequence number seen, lost or not */
+	int depth;	/* current delay in slots */
+	int calm;	/* slots played since the last late packet */
+	unsigned int late;	/* packets which missed their slot */
+	unsigned int reordered;	/* packets which were late but made it */
+	int behind;	/* packets in a row far behind, see opus_playout_behind() */
+	int behind_next;	/* sequence number which continues that row */
+	struct opus_playout_slot slot[PLAYOUT_SLOTS];
+};
+
+struct opus_attr {
+	unsigned int maxbitrate;
+	unsigned int maxplayrate;
+	unsigned int unused; /* was minptime */
+	unsigned int stereo;
+	unsigned int cbr;
+	unsigned int fec;
+	unsigned int dtx;
+	unsigned int spropmaxcapturerate; /* FIXME: not utilised, yet */
+	unsigned int spropstereo; /* FIXME: currently, we are just mono */
+	/* encoder settings, -1 = of the profile, see opus_encoder_settings() */
+	int complexity;
+	int application; /* CODEC_OPUS_APPLICATION_* */
+	int signal; /* CODEC_OPUS_SIGNAL_* */
+	int frameduration; /* ms */
+	int packetloss; /* percent */
+};
+
+/*! \brief Encoder settings of a profile in codec_opus.conf */
+struct opus_profile {
+	int application;
+	int complexity;	/* -1 = default of the library */
+	int signal;
+	int frame_duration;	/* ms */
+	int bitrate;	/* 0 = as negotiated */
+	int packet_loss;	/* expected, in percent */
+};
+
+/*! \brief Slots per case, see opus_decode_frame() */
+struct opus_decode_stats {
+	unsigned int decoded;	/* case 1 */
+	unsigned int recovered;	/* case 2, via FEC */
+	unsigned int concealed;	/* case 3, via PLC */
+	unsigned int noise;	/* case 3 beyond PLC_MAX_SLOTS, or DTX */
+	unsigned int skipped;	/* silence, not decoded */
+};
+
+enum opus_companding {
+	COMPANDING_NONE = 0,	/* slin */
+	COMPANDING_ULAW,
+	COMPANDING_ALAW,
+};
+
+struct opus_coder_pvt {
+	void *opus;	/* May be encoder or decoder */
+	int sampling_rate;
+	int multiplier;
+	int id;
+	int16_t buf[BUFFER_SAMPLES * MAX_CHANNELS]; /* interleaved */
+	int framesize;
+	int inited;
+	int channels;
+	int decode_fec_incoming;
+	enum opus_companding companding; /* G.711 instead of slin */
+	struct opus_resampler *resampler; /* slin32 and slin44, see opus_resample.h */
+	int slot_samples; /* duration of the last decoded packet */
+	int concealed; /* slots concealed since the last decoded packet */
+	unsigned int noise_pos;
+	int noise_gain; /* Q8, matches the comfort noise of the sender */
+	int in_dtx; /* the sender is in discontinuous transmission */
+	int silent; /* packets in a row without activity, see opus_packet_activity() */
+	int skip_silence; /* do not decode after ACTIVITY_HANGOVER silent packets */
+	int deep_plc; /* runs at PLC_STRONG_COMPLEXITY, see opus_plc_init() */
+	int timing; /* decoder only, the last frame had timing info */
+	long ts; /* decoder only, of the last frame */
+	struct opus_playout *playout; /* decoder only */
+	struct opus_decode_stats stats; /* decoder only */
+	struct opus_attr applied; /* encoder only */
+	struct opus_profile profile; /* encoder only, as applied */
+	unsigned int generation; /* of the profile */
+	int configured;
+	int activity; /* encoder only, level << 1 | active */
+	int tone; /* encoder only, packets in a row from the tone cache */
+	uint64_t tone_previous; /* encoder only, hash of the frame before, 0 = unknown */
+	struct opus_flight *flight; /* see codec_opus_open_source.c */
+};
+
+static inline int seqno_diff(int a, int b)
+{
+	return (int16_t) (a - b); /* RTP sequence numbers wrap at 16 bit */
+}
+
+static void comfort_noise_init(void)
+{
+	unsigned int seed = 0x4f505553; /* "OPUS" */
+	int i;
+
+	/* White noise at about -70 dBov, generated once; see opus_conceal() */
+	for (i = 0; i < ARRAY_LEN(comfort_noise); i++) {
+		seed = seed * 1103515245 + 12345;
+		comfort_noise[i] = (int16_t) ((seed >> 16) & 0x1f) - 16;
+	}
+}
+
+/*!
+ * \brief Where the decoder writes its next samples
+ *
+ * For slin, this is the output buffer directly. The fused G.711 translators
+ * decode into the scratch buffer and compand in opus_output_commit(), as do
+ * the translators to slin32 and slin44 resample.
+ */
+static inline opus_int16 *opus_output(struct ast_trans_pvt *pvt)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+
+	if (opvt->companding || opvt->resampler) {
+		return opvt->buf;
+	}
+
+	return pvt->outbuf.i16 + (pvt->samples * opvt->channels);
+}
+
+static void opus_output_commit(struct ast_trans_pvt *pvt, int samples)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	unsigned char *dst = pvt->outbuf.uc + pvt->samples;
+	const opus_int16 *src = opvt->buf;
+	int i;
+
+	if (opvt->resampler) {
+		const int out = opus_resample(opvt->resampler, pvt->outbuf.i16 + pvt->samples, src, samples, 1);
+
+		pvt->samples += out;
+		pvt->datalen += out * sizeof(int16_t);
+		return;
+	}
+
+	switch (opvt->companding) {
+	case COMPANDING_NONE:
+		pvt->samples += samples;
+		pvt->datalen += samples * opvt->channels * sizeof(int16_t);
+		return;
+	case COMPANDING_ULAW:
+		for (i = 0; i < samples; i++) {
+			dst[i] = AST_LIN2MU(src[i]);
+		}
+		break;
+	case COMPANDING_ALAW:
+		for (i = 0; i < samples; i++) {
+			dst[i] = AST_LIN2A(src[i]);
+		}
+		break;
+	}
+
+	pvt->samples += samples;
+	pvt->datalen += samples;
+}
+
+/*!
+ * \brief Append comfort noise from the precomputed table
+ *
+ * \return Amount of samples added to the output buffer
+ */
+static int opus_comfort_noise(struct ast_trans_pvt *pvt, int samples)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	opus_int16 *dst = opus_output(pvt);
+	int remaining = samples * opvt->channels;
+
+	while (remaining) {
+		const int pos = opvt->noise_pos % ARRAY_LEN(comfort_noise);
+		const int chunk = MIN(remaining, ARRAY_LEN(comfort_noise) - pos);
+		const int gain = opvt->noise_gain;
+		int i;
+
+		for (i = 0; i < chunk; i++) {
+			dst[i] = (comfort_noise[pos + i] * gain) >> 8;
+		}
+		dst += chunk;
+		remaining -= chunk;
+		opvt->noise_pos = pos + chunk;
+	}
+
+	opus_output_commit(pvt, samples);
+
+	return samples;
+}
+
+/*!
+ * \brief Whether a packet is a DTX packet
+ *
+ * In discontinuous transmission, the encoder creates packets without any
+ * frame data, just the TOC byte (and the frame count). A decoder does PLC
+ * for them, which synthesises comfort noise.
+ */
+static inline int opus_packet_is_dtx(const unsigned char *src, opus_int32 len)
+{
+	return len <= 2;
+}
+
+/*!
+ * \brief Estimate from the packet alone whether the sender is active
+ *
+ * SILK codes a voice-activity flag for each of its 20 ms frames as the first
+ * symbols of an Opus frame, with a probability of one half each. Therefore,
+ * those flags are the top bits of the first byte; in stereo, the flag for
+ * the low-bitrate redundancy and then the flags of the side channel follow.
+ * CELT has no such flag, but spends at most CELT_SILENCE_BYTES on a frame
+ * of digital silence. DTX packets are silence as well.
+ *
+ * \return 1 when active, 0 when silent
+ */
+static int opus_packet_activity(const unsigned char *src, opus_int32 len)
+{
+	const unsigned char *frames[48];
+	opus_int16 sizes[48];
+	unsigned char toc;
+	int silk_frames;
+	int mask;
+	int count;
+	int i;
+
+	if (opus_packet_is_dtx(src, len)) {
+		return 0;
+	}
+	count = opus_packet_parse(src, len, &toc, frames, sizes, NULL);
+	if (count <= 0) {
+		return 1; /* the decoder will complain */
+	}
+
+	if (16 <= toc >> 3) { /* CELT only */
+		for (i = 0; i < count; i++) {
+			if (CELT_SILENCE_BYTES < sizes[i]) {
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	/* SILK or hybrid: one SILK frame per 10 or 20 ms, two per 40 ms, three per 60 ms */
+	silk_frames = MAX(opus_packet_get_samples_per_frame(src, 48000) / 960, 1);
+	mask = ((1 << silk_frames) - 1) << (8 - silk_frames);
+	if (opus_packet_get_nb_channels(src) == 2) {
+		mask |= mask >> (silk_frames + 1);
+	}
+	for (i = 0; i < count; i++) {
+		if (sizes[i] && (frames[i][0] & mask)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*! \brief Whether the decoder stopped decoding because the sender is silent */
+static inline int opus_decoder_resting(const struct opus_coder_pvt *opvt)
+{
+	return opvt->skip_silence && ACTIVITY_HANGOVER < opvt->silent;
+}
+
+/*!
+ * \brief Append digital silence instead of decoding
+ *
+ * \return Amount of samples added to the output buffer
+ */
+static int opus_silence(struct ast_trans_pvt *pvt, int samples)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+
+	memset(opus_output(pvt), 0, samples * opvt->channels * sizeof(opus_int16));
+	opus_output_commit(pvt, samples);
+
+	return samples;
+}
+
+/*!
+ * \brief Match the level of our comfort noise to the one of the sender
+ */
+static void opus_comfort_noise_level(struct opus_coder_pvt *opvt, const opus_int16 *pcm, int samples)
+{
+	int sum = 0;
+	int i;
+
+	if (samples <= 0) {
+		return;
+	}
+	for (i = 0; i < samples; i++) {
+		sum += abs(pcm[i]);
+	}
+	/* the mean magnitude of the table is 8 */
+	opvt->noise_gain = MIN(sum / samples * (256 / 8), 256 * 256);
+}
+
+/*!
+ * \brief Decode one slot of the playout into the output buffer
+ *
+ * \param src Opus packet
+ * \param decode_fec Recover the previous slot from the FEC data in src
+ * \param discard Decode for the state of the decoder only
+ *
+ * \return Amount of samples added to the output buffer
+ */
+static int opus_decode_slot(struct ast_trans_pvt *pvt, const unsigned char *src, opus_int32 len, int decode_fec, int discard)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const int room = pvt->t->buffer_samples - pvt->samples;
+	opus_int16 *dst = opus_output(pvt);
+	int frame_size;
+	int status;
+
+	if (!decode_fec && opus_packet_is_dtx(src, len)) {
+		if (opvt->in_dtx) {
+			/* The library decoded one of those already; we take over */
+			status = opus_packet_get_nb_samples(src, len, opvt->sampling_rate);
+			if (status <= 0) {
+				status = opvt->slot_samples;
+			}
+			opvt->slot_samples = status;
+			opvt->stats.noise++;
+			return discard ? 0 : opus_comfort_noise(pvt, MIN(status, room));
+		}
+		opvt->in_dtx = 1;
+	} else if (!decode_fec) {
+		opvt->in_dtx = 0;
+	}
+
+	/*
+	 * After a while without activity, the decoder rests, which saves the CPU
+	 * for the participants of a conference who listen. Because its state is
+	 * out of date then, it starts over with the next active packet.
+	 */
+	if (!decode_fec && opus_packet_activity(src, len)) {
+		if (opus_decoder_resting(opvt)) {
+			opus_decoder_ctl(opvt->opus, OPUS_RESET_STATE);
+		}
+		opvt->silent = 0;
+	} else if (!decode_fec) {
+		opvt->silent = MIN(opvt->silent + 1, ACTIVITY_HANGOVER + 1);
+	}
+	if (opus_decoder_resting(opvt)) {
+		if (!decode_fec) {
+			status = opus_packet_get_nb_samples(src, len, opvt->sampling_rate);
+			if (0 < status) {
+				opvt->slot_samples = status;
+			}
+		}
+		opvt->stats.skipped++;
+		return discard ? 0 : opus_silence(pvt, MIN(opvt->slot_samples, room));
+	}
+
+	if (decode_fec) {
+		frame_size = opvt->slot_samples;
+	} else {
+		frame_size = BUFFER_SAMPLES / opvt->multiplier; /* parse everything */
+	}
+	if (room < frame_size) {
+		frame_size = room;
+	}
+
+	status = opus_decode(opvt->opus, src, len, dst, frame_size, decode_fec);
+	if (status < 0) {
+		ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
+		return 0;
+	}
+	if (!decode_fec) {
+		opvt->slot_samples = status;
+		opvt->stats.decoded++;
+	} else {
+		opvt->stats.recovered++;
+	}
+	if (opvt->in_dtx) {
+		opus_comfort_noise_level(opvt, dst, status * opvt->channels);
+	}
+	opvt->concealed = 0;
+	if (discard) {
+		return 0; /* the next slot overwrites those samples */
+	}
+
+	opus_output_commit(pvt, status);
+
+	return status;
+}
+
+/*! \brief The monotonic clock in ns, of the module and opus_replay as well */
+static long long monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*!
+ * \brief Prepare a new decoder for the best tier
+ *
+ * The deep PLC learns from the decoded audio, therefore it has to run all
+ * the time, not just when a packet is lost. Without it in libopus, the
+ * complexity of the decoder changes nothing.
+ */
+static void opus_plc_init(struct opus_coder_pvt *opvt)
+{
+#if defined(OPUS_SET_DNN_BLOB_REQUEST)
+	if (plc_budget.tier == PLC_TIER_STRONG
+		&& opus_decoder_ctl(opvt->opus, OPUS_SET_COMPLEXITY(PLC_STRONG_COMPLEXITY)) == OPUS_OK) {
+		opvt->deep_plc = 1;
+	}
+#endif
+}
+
+/*!
+ * \brief Choose the tier for concealing up to *slots slots
+ *
+ * With more than half of the budget left, the best tier; with less, the
+ * classic PLC at most; without, comfort noise. Furthermore, a call gets
+ * not more slots than the budget left pays for, so a burst of loss on many
+ * calls at once cannot saturate the machine.
+ */
+static int opus_plc_tier(const struct opus_coder_pvt *opvt, int *slots)
+{
+	const int percent = plc_budget.cpu_percent;
+	const long long burst = percent * 10000000LL; /* one second worth */
+	const long long now = monotonic_ns();
+	long long last = __atomic_load_n(&plc_budget.refilled_ns, __ATOMIC_RELAXED);
+	int tier = opvt->deep_plc ? PLC_TIER_STRONG : MIN(plc_budget.tier, PLC_TIER_CLASSIC);
+	long long tokens;
+	int cost;
+
+	if (!percent) {
+		return tier;
+	}
+
+	/* whoever wins the race refills for the time since the last refill */
+	if (last < now && __atomic_compare_exchange_n(&plc_budget.refilled_ns, &last, now,
+		0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		tokens = __atomic_add_fetch(&plc_budget.tokens, last ? (now - last) * percent / 100 : burst,
+			__ATOMIC_RELAXED);
+		if (burst < tokens) {
+			__atomic_store_n(&plc_budget.tokens, burst, __ATOMIC_RELAXED);
+		}
+	}
+	tokens = __atomic_load_n(&plc_budget.tokens, __ATOMIC_RELAXED);
+
+	if (tokens <= 0) {
+		return PLC_TIER_NOISE;
+	} else if (tokens < burst / 2) {
+		tier = MIN(tier, PLC_TIER_CLASSIC);
+	}
+
+	cost = plc_budget.slot_ns[tier];
+	if (cost && tokens / cost < *slots) {
+		*slots = tokens / cost;
+	}
+
+	return *slots ? tier : PLC_TIER_NOISE;
+}
+
+/*! \brief Pay for a PLC call, and learn its costs per slot */
+static void opus_plc_account(int tier, int slots, long long ns)
+{
+	const int cost = plc_budget.slot_ns[tier];
+
+	if (!plc_budget.cpu_percent || !slots) {
+		return;
+	}
+
+	__atomic_sub_fetch(&plc_budget.tokens, ns, __ATOMIC_RELAXED);
+	/* moving average; a race loses one sample only */
+	plc_budget.slot_ns[tier] = cost ? cost + (ns / slots - cost) / 8 : ns / slots;
+}
+
+/*!
+ * \brief Conceal lost slots, all with one call into the decoder
+ *
+ * The first PLC_MAX_SLOTS slots of a burst get PLC; the Opus library fades
+ * out anyway. Any further slot gets comfort noise, which costs nearly
+ * nothing, no matter how long the burst is. While the sender is in DTX,
+ * there is nothing to conceal; all slots get comfort noise. Under the CPU
+ * budget for PLC, see opus_plc_tier(), fewer slots get PLC or a cheaper one.
+ *
+ * \return Amount of samples added to the output buffer
+ */
+static int opus_conceal(struct ast_trans_pvt *pvt, int slots)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	const int room = pvt->t->buffer_samples - pvt->samples;
+	int plc = opvt->in_dtx ? 0 : MAX(MIN(slots, PLC_MAX_SLOTS - opvt->concealed), 0);
+	const int tier = plc ? opus_plc_tier(opvt, &plc) : PLC_TIER_NOISE;
+	int noise;
+	int added = 0;
+
+	if (opus_decoder_resting(opvt)) {
+		/* nothing to conceal in silence */
+		opvt->concealed += slots;
+		opvt->stats.skipped += slots;
+		return opus_silence(pvt, MIN(slots * opvt->slot_samples, room));
+	}
+
+	if (tier == PLC_TIER_NOISE) {
+		plc = 0;
+	}
+	noise = (slots - plc) * opvt->slot_samples;
+
+	opvt->concealed += slots;
+	opvt->stats.concealed += plc;
+	opvt->stats.noise += slots - plc;
+	OPUS_PROBE(conceal, opvt->id, opvt->sampling_rate, plc, slots - plc, tier);
+
+	if (plc) {
+		opus_int16 *dst = opus_output(pvt);
+		const int frame_size = MIN(plc * opvt->slot_samples, room);
+		const long long start = plc_budget.cpu_percent ? monotonic_ns() : 0;
+		int status;
+
+		if (opvt->deep_plc && tier != PLC_TIER_STRONG) {
+			opus_decoder_ctl(opvt->opus, OPUS_SET_COMPLEXITY(0));
+		}
+		status = opus_decode(opvt->opus, NULL, 0, dst, frame_size, 0);
+		if (opvt->deep_plc && tier != PLC_TIER_STRONG) {
+			opus_decoder_ctl(opvt->opus, OPUS_SET_COMPLEXITY(PLC_STRONG_COMPLEXITY));
+		}
+		if (start) {
+			opus_plc_account(tier, plc, monotonic_ns() - start);
+		}
+
+		if (status < 0) {
+			ast_log(LOG_ERROR, "%s\n", opus_strerror(status));
+		} else {
+			opus_output_commit(pvt, status);
+			added += status;
+		}
+	}
+
+	if (noise) {
+		added += opus_comfort_noise(pvt, MIN(noise, room - added));
+	}
+
+	return added;
+}
+
+/*!
+ * \brief The packet of a slot, either the current frame or from the buffer
+ */
+static const unsigned char *opus_playout_packet(struct opus_playout *po, struct ast_frame *f, int seqno, int *len)
+{
+	struct opus_playout_slot *slot = &po->slot[seqno & PLAYOUT_MASK];
+
+	if (f->datalen && (f->seqno & 0xffff) == seqno) {
+		*len = f->datalen; /* arrived just in time, no copy required */
+		return f->data.ptr;
+	} else if (slot->datalen && slot->seqno == seqno) {
+		*len = slot->datalen;
+		return slot->data;
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Play out the next slot: decode, recover via FEC, or conceal
+ *
+ * \return Amount of slots played out
+ */
+static int opus_playout_slot(struct ast_trans_pvt *pvt, struct ast_frame *f, int discard)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	struct opus_playout *po = opvt->playout;
+	struct opus_playout_slot *slot = &po->slot[po->next & PLAYOUT_MASK];
+	const int fec = opvt->decode_fec_incoming;
+	const unsigned char *src;
+	int slots = 1;
+	int len;
+
+	if ((src = opus_playout_packet(po, f, po->next, &len))) {
+		/* Case 1: we have the packet */
+		OPUS_PROBE(decode, opvt->id, opvt->sampling_rate, po->next, len, discard);
+		opus_decode_slot(pvt, src, len, 0, discard);
+	} else if (fec && (src = opus_playout_packet(po, f, (po->next + 1) & 0xffff, &len))) {
+		/* Case 2: lost, but the packet of the next slot carries FEC for it */
+		OPUS_PROBE(fec, opvt->id, opvt->sampling_rate, po->next, len, discard);
+		opus_decode_slot(pvt, src, len, 1, discard);
+	} else {
+		/* Case 3: lost without FEC; conceal all lost slots which follow, too */
+		while (po->depth <= seqno_diff(po->highest, po->next + slots)
+			&& !opus_playout_packet(po, f, (po->next + slots) & 0xffff, &len)
+			&& !(fec && opus_playout_packet(po, f, (po->next + slots + 1) & 0xffff, &len))) {
+			slots++;
+		}
+		OPUS_PROBE(plc, opvt->id, opvt->sampling_rate, po->next, slots, discard);
+		opus_conceal(pvt, slots - discard); /* skipping a lost slot is free */
+		if (fec && !po->depth) {
+			/* FEC needs the next packet; wait for it from now on */
+			po->depth = 1;
+			po->calm = 0;
+		}
+	}
+
+	if (slot->seqno == po->next) {
+		slot->datalen = 0;
+	}
+	po->next = (po->next + slots) & 0xffff;
+	po->calm += slots;
+
+	return slots;
+}
+
+/*!
+ * \brief Whether packets far behind the playout are a new stream
+ *
+ * The translator does not see the SSRC. A single packet far behind is just
+ * very late, for example after a delay spike, and gets dropped; starting
+ * over on it would play out its successors again and add latency for good.
+ * A new stream which starts lower goes on in order, though.
+ */
+static int opus_playout_behind(struct opus_playout *po, int seqno)
+{
+	if (po->behind && seqno == po->behind_next) {
+		po->behind++;
+	} else {
+		po->behind = 1;
+	}
+	po->behind_next = (seqno + 1) & 0xffff;
+
+	return PLAYOUT_SLOTS < po->behind;
+}
+
+/*!
+ * \brief Put a frame with a RTP sequence number into the playout buffer
+ *
+ * Each sequence number is one slot of the playout. The frame might be a
+ * packet, lost packets (datalen is 0) as reported by the patch for native
+ * PLC, or a late packet. Whenever the buffer is deep enough, slots are
+ * played out in order, one output frame per slot.
+ */
+static int opus_playout_put(struct ast_trans_pvt *pvt, struct ast_frame *f)
+{
+	struct opus_coder_pvt *opvt = pvt->pvt;
+	struct opus_playout *po = opvt->playout;
+	const int seqno = f->seqno & 0xffff;
+	int ticks;
+	int played = 0;
+	int discard = 0;
+	int diff;
+
+	if (!po->started) {
+		po->started = 1;
+		po->next = seqno;
+		po->highest = (seqno - 1) & 0xffff;
+	}
+
+	diff = seqno_diff(seqno, po->next);
+	if (PLAYOUT_SLOTS + PLAYOUT_MAX_BATCH <= diff
+		|| (diff < -PLAYOUT_SLOTS && f->datalen && opus_playout_behind(po, seqno))) {
+		/* The stream jumped, for example a new SSRC; start over */
+		while (seqno_diff(po->highest, po->next) >= 0) {
+			opus_playout_slot(pvt, f, 0);
+		}
+		po->next = seqno;
+		po->highest = (seqno - 1) & 0xffff;
+	} else if (diff < 0) {
+		/* The slot of this packet was played out already */
+		if (f->datalen) {
+			po->late++;
+			/* a deeper playout would not have saved one that late */
+			if (-PLAYOUT_SLOTS <= diff && po->depth < PLAYOUT_MAX_DEPTH) {
+				po->depth++;
+			}
+			po->calm = 0;
+			OPUS_PROBE(late, opvt->id, opvt->sampling_rate, seqno, f->datalen, po->depth);
+			ast_debug(5, "Decoder #%d: late packet %d, playout depth %d\n", opvt->id, seqno, po->depth);
+		}
+		return 0;
+	}
+	po->behind = 0;
+
+	ticks = seqno_diff(seqno, po->highest);
+	if (0 < ticks) {
+		po->highest = seqno;
+	} else if (f->datalen) {
+		po->reordered++; /* arrived after its successor but in time */
+	}
+
+	if (po->depth && PLAYOUT_CALM_SLOTS <= po->calm) {
+		/* No late packets for a while; shrink by skipping one slot */
+		po->depth--;
+		po->calm = 0;
+		discard = 1;
+	}
+
+	while (po->depth <= seqno_diff(po->highest, po->next)) {
+		played += opus_playout_slot(pvt, f, discard) - discard;
+		discard = 0;
+	}
+
+	if (f->datalen && 0 <= seqno_diff(seqno, po->next)) {
+		/* This packet was not played out right away; keep a copy */
+		struct opus_playout_slot *slot = &po->slot[seqno & PLAYOUT_MASK];
+
+		if (f->datalen <= sizeof(slot->data)) {
+			memcpy(slot->data, f->data.ptr, f->datalen);
+			slot->datalen = f->datalen;
+			slot->seqno = seqno;
+		} else {
+			ast_log(LOG_WARNING, "Decoder #%d: packet %d too large (%d bytes)\n", opvt->id, seqno, f->datalen);
+		}
+	}
+
+	/* The playout depth grew; fill the slots of this tick by stretching */
+	if (played < ticks) {
+		opus_conceal(pvt, ticks - played);
+	}
+
+	return 0;
+}
+
+/*!
+ * \brief Decode a frame, or conceal the lost frames it stands for
+ *
+ * \note The decoder has to be constructed already.
+ */
+static int opus_decode_frame(struct ast_trans_pvt *pvt, struct ast_frame *f)
+{
+	/*
+	 * The Opus Codec, actually its library allows
+	 * - Forward-Error Correction (FEC), and
+	 * - native Packet-Loss Concealment (PLC).
+	 * The sender might include FEC. If there is no FEC, because it was not send
+	 * or the FEC data got lost, the API of the Opus library does PLC instead.
+	 *
+	 * Frames with a RTP sequence number go through a small playout buffer,
+	 * see opus_playout_put(). Each sequence number is a slot, and for each
+	 * slot we decide exactly once, in opus_playout_slot():
+	 * - Case 1: we have the packet, therefore we decode it; just a DTX packet
+	 *   following another one gets cheap comfort noise instead,
+	 * - Case 2: the packet got lost but FEC was negotiated and the packet of
+	 *   the next slot is here already, therefore we recover via FEC, or
+	 * - Case 3: we do PLC, for all lost slots in a row with one call.
+	 * Because of that, each slot creates just one frame. A PLC frame followed
+	 * by the decoded late packet does not double the output anymore, see
+	 * <https://issues.asterisk.org/jira/browse/ASTERISK-25483>.
+	 *
+	 * The buffer does not delay at all (depth 0) till either a packet arrives
+	 * too late for its slot or FEC could have been used. Then, the depth grows
+	 * by one slot and shrinks again after a while without late packets. That
+	 * way, late packets get decoded instead of concealed, which saves the CPU
+	 * for PLC as well.
+	 *
+	 * Some notes on the coding style of this section:
+	 * This code section is passed for each incoming frame, normally every
+	 * 20 milliseconds. For each channel, this code is passed individually.
+	 * Therefore, this code should be as performant as possible. On the other
+	 * hand, PLC plus FEC is complicated. Therefore, code readability is one
+	 * prerequisite to understand, debug, and review this code section. Because
+	 * we do have optimising compilers, we are able to sacrify optimised code
+	 * for code readability. If you find an error or unnecessary calculation
+	 * which is not optimised = removed by your compiler, please, create an
+	 * issue on <https://github.com/traud/asterisk-opus/issues>. I am just
+	 * a human and human do mistakes. However, humans love to learn.
+	 *
+	 * Source-code examples are
+	 * - <https://git.xiph.org/?p=opus.git;a=history;f=src/opus_demo.c>,
+	 * - <https://freeswitch.org/stash/projects/FS/repos/freeswitch/browse/src/mod/codecs/mod_opus/mod_opus.c>
+	 * and the official mailing list itself:
+	 * <https://www.google.de/search?q=site:lists.xiph.org+opus>.
+	 */
+	if (ast_test_flag(f, AST_FRFLAG_HAS_TIMING_INFO)) {
+		return opus_playout_put(pvt, f);
+	}
+
+	/*
+	 * Without a sequence number, like sample frames or frames interpolated by
+	 * a jitter buffer, we decode or conceal right away. Because there is no
+	 * gap in the sequence numbers, an interpolated frame after a DTX packet
+	 * is silence, not loss; opus_conceal() creates just comfort noise then.
+	 */
+	if (f->datalen == 0) {
+		opus_conceal(pvt, 1);
+	} else {
+		opus_decode_slot(pvt, f->data.ptr, f->datalen, 0, 0);
+	}
+
+	return 0;
+}
+
+#endif /* _CODEC_OPUS_DECODE_H */
@@ -0,0 +1,226 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Resampling between slin32 or slin44 and the 48 kHz of Opus
+ *
+ * Opus does not code 32 kHz or 44.1 kHz. Instead of a resampling translator
+ * of the core in front of lin48toopus, and behind opustolin48, the Opus
+ * translators of these rates resample themselves: straight from the frame
+ * into the buffer of the encoder, and from the scratch buffer of the decoder
+ * into the output. That is one translator step and one frame less per 20 ms.
+ *
+ * A polyphase FIR filter: for the ratio up/down, the prototype low-pass at
+ * up times the input rate has up phases of RESAMPLE_TAPS coefficients each.
+ * Each output sample is the dot product of one phase with the latest input
+ * samples, a fixed-length loop of 16-bit products which the compiler turns
+ * into SIMD instructions (-O3).
+ *
+ * Shared by codec_opus_open_source.c and utils/opus_replay.c via
+ * opus_decode.h. Mono only; stereo input gets downmixed on the way in.
+ */
+
+#ifndef _CODEC_OPUS_RESAMPLE_H
+#define _CODEC_OPUS_RESAMPLE_H
+
+#include <math.h>                       /* for sin, cos */
+#include <stdint.h>                     /* for int16_t */
+#include <string.h>                     /* for memmove */
+
+#define	RESAMPLE_TAPS	32	/* per phase, a multiple of the SIMD width */
+#define	RESAMPLE_CHUNK	480	/* input samples per pass */
+#define	RESAMPLE_PASSBAND	0.45	/* of the lower rate, about 14 kHz at 32 kHz */
+
+struct opus_resample_filter {
+	const int from;
+	const int to;
+	const int up;
+	const int down;
+	int16_t *coeffs; /* up phases of RESAMPLE_TAPS, each in input order */
+};
+
+struct opus_resampler {
+	const struct opus_resample_filter *filter;
+	int index; /* input sample of the next output sample */
+	int phase; /* and its fraction in 1/up */
+	int16_t work[RESAMPLE_TAPS - 1 + RESAMPLE_CHUNK]; /* history, then input */
+};
+
+static struct opus_resample_filter resample_filters[] = {
+	{ 32000, 48000,   3,   2, NULL },
+	{ 44100, 48000, 160, 147, NULL },
+	{ 48000, 32000,   2,   3, NULL },
+	{ 48000, 44100, 147, 160, NULL },
+};
+
+/*!
+ * \brief The rate of the Opus encoder or decoder for a slin rate
+ */
+static inline int opus_native_rate(int rate)
+{
+	switch (rate) {
+	case 8000:
+	case 12000:
+	case 16000:
+	case 24000:
+	case 48000:
+		return rate;
+	}
+
+	return 48000;
+}
+
+/*!
+ * \brief Design the filters, once on load
+ *
+ * A windowed sinc (Blackman) with its cutoff at RESAMPLE_PASSBAND of the
+ * lower rate. Each phase gets normalised to a gain of one, in Q15.
+ *
+ * \retval 0 on success
+ * \retval -1 out of memory
+ */
+static int opus_resample_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(resample_filters); i++) {
+		struct opus_resample_filter *filter = &resample_filters[i];
+		const int up = filter->up;
+		const int length = up * RESAMPLE_TAPS;
+		const double cutoff = RESAMPLE_PASSBAND * MIN(filter->from, filter->to) / ((double) filter->from * up);
+		double *h;
+		int p;
+		int n;
+
+		if (filter->coeffs) {
+			continue;
+		}
+		h = malloc(length * sizeof(*h));
+		filter->coeffs = malloc(length * sizeof(*filter->coeffs));
+		if (!h || !filter->coeffs) {
+			free(h);
+			return -1;
+		}
+
+		for (n = 0; n < length; n++) {
+			const double t = n - (length - 1) / 2.0;
+			const double x = 2 * M_PI * cutoff * t;
+			const double w = 0.42 - 0.5 * cos(2 * M_PI * n / (length - 1)) + 0.08 * cos(4 * M_PI * n / (length - 1));
+
+			h[n] = (t == 0 ? 1.0 : sin(x) / x) * w;
+		}
+
+		for (p = 0; p < up; p++) {
+			int16_t *c = filter->coeffs + p * RESAMPLE_TAPS;
+			double sum = 0;
+			int j;
+
+			for (j = 0; j < RESAMPLE_TAPS; j++) {
+				sum += h[p + j * up];
+			}
+			/* h[p + j * up] weighs the input sample j before the latest one */
+			for (j = 0; j < RESAMPLE_TAPS; j++) {
+				c[RESAMPLE_TAPS - 1 - j] = lrint(32767 * h[p + j * up] / sum);
+			}
+		}
+		free(h);
+	}
+
+	return 0;
+}
+
+static void opus_resample_destroy_filters(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(resample_filters); i++) {
+		free(resample_filters[i].coeffs);
+		resample_filters[i].coeffs = NULL;
+	}
+}
+
+/*!
+ * \brief The filter between two rates
+ *
+ * \return NULL, when Opus supports the rate, or when the filters are not
+ * initialised
+ */
+static const struct opus_resample_filter *opus_resample_filter(int from, int to)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(resample_filters); i++) {
+		if (resample_filters[i].from == from && resample_filters[i].to == to) {
+			return resample_filters[i].coeffs ? &resample_filters[i] : NULL;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Resample into the destination, for example the buffer of the encoder
+ *
+ * \param channels of the input; stereo gets downmixed while copied
+ *
+ * \return Amount of samples written, at most samples * up / down + 1
+ */
+static int opus_resample(struct opus_resampler *r, int16_t *dst, const int16_t *src, int samples, int channels)
+{
+	const struct opus_resample_filter *filter = r->filter;
+	int16_t *input = r->work + RESAMPLE_TAPS - 1;
+	int out = 0;
+
+	while (samples) {
+		const int chunk = MIN(samples, RESAMPLE_CHUNK);
+		int i;
+
+		if (channels == 2) {
+			for (i = 0; i < chunk; i++) {
+				input[i] = (src[2 * i] + src[2 * i + 1]) >> 1;
+			}
+		} else {
+			memcpy(input, src, chunk * sizeof(*input));
+		}
+
+		while (r->index < chunk) {
+			const int16_t *c = filter->coeffs + r->phase * RESAMPLE_TAPS;
+			const int16_t *x = r->work + r->index;
+			int32_t acc = 1 << 14;
+			int j;
+
+			for (j = 0; j < RESAMPLE_TAPS; j++) {
+				acc += c[j] * x[j];
+			}
+			acc >>= 15;
+			dst[out++] = acc > INT16_MAX ? INT16_MAX : acc < INT16_MIN ? INT16_MIN : acc;
+
+			r->phase += filter->down;
+			while (r->phase >= filter->up) {
+				r->phase -= filter->up;
+				r->index++;
+			}
+		}
+
+		r->index -= chunk;
+		memmove(r->work, r->work + chunk, (RESAMPLE_TAPS - 1) * sizeof(*r->work));
+		src += chunk * channels;
+		samples -= chunk;
+	}
+
+	return out;
+}
+
+#endif /* _CODEC_OPUS_RESAMPLE_H */
@@ -61,4 +61,100 @@
 #define CODEC_OPUS_DEFAULT_DTX 0
 #define CODEC_OPUS_DEFAULT_STEREO 0
 
+/*!
+ * \brief Encoder settings as format attributes, not negotiated via SDP
+ *
+ * Set with ast_format_attribute_set() under the names complexity (0 to 10),
+ * application (voip, audio, restricted_lowdelay), signal (auto, voice,
+ * music), frame_duration (10, 20, 40, 60 ms), and packet_loss (0 to 100
+ * percent), for example per endpoint. Each overrides the profile of
+ * codec_opus.conf; -1 leaves it to the profile.
+ */
+#define CODEC_OPUS_APPLICATION_VOIP 0
+#define CODEC_OPUS_APPLICATION_AUDIO 1
+#define CODEC_OPUS_APPLICATION_RESTRICTED_LOWDELAY 2
+#define CODEC_OPUS_SIGNAL_AUTO 0
+#define CODEC_OPUS_SIGNAL_VOICE 1
+#define CODEC_OPUS_SIGNAL_MUSIC 2
+
+struct ast_trans_pvt;
+
+/*! \brief Voice activity of the last frame of an Opus encoder */
+struct ast_opus_activity {
+	/*! Voice (1) or silence (0) */
+	int active;
+	/*! Level of the input in -dBov, 0 (loudest) to 127 (silence), like RFC 6464 */
+	int level;
+};
+
+/*!
+ * \brief Get the voice activity of the Opus encoder at the end of a translation path
+ *
+ * The encoder of codec_opus_open_source analyzes each frame anyway. A bridge
+ * or mixer can use this instead of its own talk detection on the same audio,
+ * for example on the write translation path of a channel.
+ *
+ * \note The channel frees its translation paths whenever it rebuilds them,
+ * for example on a change of format. The caller has to hold the lock of
+ * the channel from fetching the path until this returns; a path must not
+ * be kept beyond the lock.
+ *
+ * \param path Translation path, for example ast_channel_writetrans()
+ * \param activity Set on success
+ *
+ * \retval 0 success
+ * \retval -1 the path does not end in an Opus encoder of codec_opus_open_source
+ */
+int ast_opus_get_activity(const struct ast_trans_pvt *path, struct ast_opus_activity *activity);
+
+/*!
+ * \brief Get the activity of the sender of the Opus decoder at the start of a translation path
+ *
+ * Estimated from the Opus packets, without decoding them: from the voice
+ * activity flags of SILK, the size of CELT frames, and DTX. A mixer can
+ * leave out a silent participant. With skip_silence in codec_opus.conf, the
+ * decoder itself stops decoding shortly after the sender became silent.
+ *
+ * \note As for ast_opus_get_activity(), the caller has to hold the lock of
+ * the channel from fetching the path until this returns.
+ *
+ * \param path Translation path, for example ast_channel_readtrans()
+ *
+ * \retval 1 active
+ * \retval 0 silent
+ * \retval -1 the path does not start with an Opus decoder of codec_opus_open_source
+ */
+int ast_opus_get_decoder_activity(const struct ast_trans_pvt *path);
+
+struct ast_frame;
+struct ast_opus_recorder;
+
+/*!
+ * \brief Start a recording of several tracks into one Ogg Opus file
+ *
+ * Each track, for example each participant of a conference, becomes a mono
+ * stream of its own (channel mapping family 255). Opus frames of 20 ms get
+ * recorded as they are, without transcoding.
+ *
+ * \param filename The file to create
+ * \param tracks 1 to 255
+ * \param names NULL, or the name of each track, which may be NULL
+ *
+ * \return The recording, or NULL on error
+ */
+struct ast_opus_recorder *ast_opus_recorder_create(const char *filename, int tracks, const char * const *names);
+
+/*!
+ * \brief Record a voice frame, Opus or slin, on a track
+ *
+ * Thread-safe. Tracks without frames in a period of 20 ms get silence.
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int ast_opus_recorder_write(struct ast_opus_recorder *recorder, int track, struct ast_frame *frame);
+
+/*! \brief Finish the file and free the recording */
+void ast_opus_recorder_destroy(struct ast_opus_recorder *recorder);
+
 #endif /* _AST_FORMAT_OPUS_H */
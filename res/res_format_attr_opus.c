@@ -57,6 +57,12 @@ struct opus_attr {
 	unsigned int dtx;
 	unsigned int spropmaxcapturerate;
 	unsigned int spropstereo;
+	/* encoder settings, -1 = of the profile in codec_opus.conf */
+	int complexity;
+	int application; /* CODEC_OPUS_APPLICATION_* */
+	int signal; /* CODEC_OPUS_SIGNAL_* */
+	int frameduration; /* ms */
+	int packetloss; /* percent */
 };
 
 static struct opus_attr default_opus_attr = {
@@ -68,8 +74,17 @@ static struct opus_attr default_opus_attr = {
 	.cbr                 = CODEC_OPUS_DEFAULT_CBR,
 	.fec                 = CODEC_OPUS_DEFAULT_FEC,
 	.dtx                 = CODEC_OPUS_DEFAULT_DTX,
+	.complexity          = -1,
+	.application         = -1,
+	.signal              = -1,
+	.frameduration       = -1,
+	.packetloss          = -1,
 };
 
+/* In the order of CODEC_OPUS_APPLICATION_* and CODEC_OPUS_SIGNAL_* */
+static const char * const opus_applications[] = { "voip", "audio", "restricted_lowdelay", };
+static const char * const opus_signals[] = { "auto", "voice", "music", };
+
 static void opus_destroy(struct ast_format *format)
 {
 	struct opus_attr *attr = ast_format_get_attribute_data(format);
@@ -294,16 +309,62 @@ static struct ast_format *opus_getjoint(const struct ast_format *format1, const
 	attr_res->spropmaxcapturerate = MIN(attr1->spropmaxcapturerate, attr2->spropmaxcapturerate);
 	attr_res->maxplayrate = MIN(attr1->maxplayrate, attr2->maxplayrate);
 
+	/* Encoder settings are local, not negotiated; usually just one side has them */
+	if (attr_res->complexity < 0) {
+		attr_res->complexity = attr2->complexity;
+	}
+	if (attr_res->application < 0) {
+		attr_res->application = attr2->application;
+	}
+	if (attr_res->signal < 0) {
+		attr_res->signal = attr2->signal;
+	}
+	if (attr_res->frameduration < 0) {
+		attr_res->frameduration = attr2->frameduration;
+	}
+	if (attr_res->packetloss < 0) {
+		attr_res->packetloss = attr2->packetloss;
+	}
+
 	return jointformat;
 }
 
+/*! \brief The index of the value in the keywords, like CODEC_OPUS_SIGNAL_* */
+static int opus_keyword(const char *value, const char * const *keywords, unsigned int count, unsigned int *val)
+{
+	for (*val = 0; *val < count; (*val)++) {
+		if (!strcasecmp(value, keywords[*val])) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 static struct ast_format *opus_set(const struct ast_format *format, const char *name, const char *value)
 {
 	struct ast_format *cloned;
 	struct opus_attr *attr;
 	unsigned int val;
+	int valid;
+
+	if (!strcasecmp(name, "application")) {
+		valid = opus_keyword(value, opus_applications, ARRAY_LEN(opus_applications), &val);
+	} else if (!strcasecmp(name, "signal")) {
+		valid = opus_keyword(value, opus_signals, ARRAY_LEN(opus_signals), &val);
+	} else {
+		valid = sscanf(value, "%30u", &val) == 1;
+	}
+
+	if (!strcasecmp(name, "complexity")) {
+		valid = valid && val <= 10;
+	} else if (!strcasecmp(name, "frame_duration")) {
+		valid = valid && (val == 10 || val == 20 || val == 40 || val == 60);
+	} else if (!strcasecmp(name, "packet_loss")) {
+		valid = valid && val <= 100;
+	}
 
-	if (sscanf(value, "%30u", &val) != 1) {
+	if (!valid) {
 		ast_log(LOG_WARNING, "Unknown value '%s' for attribute type '%s'\n",
 			value, name);
 		return NULL;
@@ -333,6 +394,16 @@ static struct ast_format *opus_set(const struct ast_format *format, const char *
 		attr->spropmaxcapturerate = val;
 	} else if (!strcasecmp(name, "sprop_stereo")) {
 		attr->spropstereo = val;
+	} else if (!strcasecmp(name, "complexity")) {
+		attr->complexity = val;
+	} else if (!strcasecmp(name, "application")) {
+		attr->application = val;
+	} else if (!strcasecmp(name, "signal")) {
+		attr->signal = val;
+	} else if (!strcasecmp(name, "frame_duration")) {
+		attr->frameduration = val;
+	} else if (!strcasecmp(name, "packet_loss")) {
+		attr->packetloss = val;
 	} else {
 		ast_log(LOG_WARNING, "unknown attribute type %s\n", name);
 	}
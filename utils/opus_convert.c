@@ -0,0 +1,711 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Convert sound directories to Ogg Opus prompts, in parallel
+ *
+ * Walks the given directories. For each prompt, the source of the highest
+ * quality (sln48 ... sln, wav, alaw, ulaw) is encoded to <name>.opus next
+ * to it, via libopusenc, on a pool of threads sized to the cores. A prompt
+ * is skipped when its .opus is newer than its source and has its index, or
+ * when the source still has the hash recorded in the index. The .opus is
+ * written before its index, so an interrupted conversion gets redone.
+ *
+ * Each .opus gets a sidecar <name>.opus.idx, little endian:
+ * - "OPIX", version (u32, 1), FNV-1a hash of the source (u64),
+ *   pre-skip (u32), amount of pages (u32),
+ * - per Ogg page: byte offset (u64), granule position (u64), and the
+ *   index of the first packet which starts on that page (u32).
+ * It indexes pages, not packets: a player seeks to a page with it, without
+ * parsing the file, and reads the packets from there. Nothing in this
+ * repository reads it; format_ogg_opus of Asterisk reads via libopusfile.
+ *
+ * Build with `make utils` (OPUSENC=1, the default).
+ */
+
+#define _GNU_SOURCE /* for asprintf */
+
+#include <errno.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <opusenc.h>
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define	INDEX_MAGIC	"OPIX"
+#define	INDEX_VERSION	1
+
+/* Sources by preference; the first one found of a prompt wins */
+static const struct source_type {
+	const char *extension;
+	int sampling_rate;	/* 0 = from the header (wav) */
+	enum { SOURCE_SLIN, SOURCE_WAV, SOURCE_ALAW, SOURCE_ULAW } encoding;
+} source_types[] = {
+	{ "sln48", 48000, SOURCE_SLIN },
+	{ "sln44", 44100, SOURCE_SLIN },
+	{ "sln32", 32000, SOURCE_SLIN },
+	{ "sln24", 24000, SOURCE_SLIN },
+	{ "sln16", 16000, SOURCE_SLIN },
+	{ "sln12", 12000, SOURCE_SLIN },
+	{ "sln",   8000,  SOURCE_SLIN },
+	{ "raw",   8000,  SOURCE_SLIN },
+	{ "wav",   0,     SOURCE_WAV },
+	{ "alaw",  8000,  SOURCE_ALAW },
+	{ "al",    8000,  SOURCE_ALAW },
+	{ "ulaw",  8000,  SOURCE_ULAW },
+	{ "pcm",   8000,  SOURCE_ULAW },
+};
+
+struct job {
+	char *source;	/* path */
+	const struct source_type *type;
+};
+
+/* Options */
+static int bitrate = OPUS_AUTO;
+static int complexity = 10;
+static int force;
+static int dry_run;
+static int verbose;
+
+/* Work */
+static struct job *jobs;
+static size_t jobs_count;
+static size_t jobs_size;
+static size_t jobs_next;
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Results */
+static unsigned int converted;
+static unsigned int skipped;
+static unsigned int failed;
+
+struct buffer {
+	unsigned char *data;
+	size_t len;
+	size_t size;
+};
+
+static int buffer_append(struct buffer *b, const void *data, size_t len)
+{
+	if (b->size < b->len + len) {
+		size_t size = MAX(b->size * 2, b->len + len + 65536);
+		unsigned char *data_new = realloc(b->data, size);
+
+		if (!data_new) {
+			return -1;
+		}
+		b->data = data_new;
+		b->size = size;
+	}
+	memcpy(b->data + b->len, data, len);
+	b->len += len;
+
+	return 0;
+}
+
+static int read_file(const char *path, struct buffer *b)
+{
+	FILE *in = fopen(path, "rb");
+	unsigned char chunk[65536];
+	size_t len;
+
+	if (!in) {
+		return -1;
+	}
+	while ((len = fread(chunk, 1, sizeof(chunk), in))) {
+		if (buffer_append(b, chunk, len)) {
+			fclose(in);
+			return -1;
+		}
+	}
+	fclose(in);
+
+	return 0;
+}
+
+static uint64_t fnv1a(const unsigned char *data, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static uint32_t le32(const unsigned char *p)
+{
+	return (uint32_t) p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t le64(const unsigned char *p)
+{
+	return le32(p) | (uint64_t) le32(p + 4) << 32;
+}
+
+static int16_t ulaw2lin(unsigned char value)
+{
+	int sample;
+
+	value = ~value;
+	sample = ((value & 0x0f) << 3) + 0x84;
+	sample <<= (value & 0x70) >> 4;
+
+	return (value & 0x80) ? 0x84 - sample : sample - 0x84;
+}
+
+static int16_t alaw2lin(unsigned char value)
+{
+	int seg;
+	int sample;
+
+	value ^= 0x55;
+	sample = (value & 0x0f) << 4;
+	seg = (value & 0x70) >> 4;
+	if (seg == 0) {
+		sample += 8;
+	} else {
+		sample = (sample + 0x108) << (seg - 1);
+	}
+
+	return (value & 0x80) ? sample : -sample;
+}
+
+/*!
+ * \brief Turn the source into native 16-bit samples
+ *
+ * \return Amount of samples per channel, or -1
+ */
+static long source_pcm(const struct source_type *type, struct buffer *source, int16_t **pcm, int *sampling_rate, int *channels)
+{
+	const unsigned char *data = source->data;
+	size_t len = source->len;
+	int encoding = type->encoding;
+	long samples;
+	long i;
+
+	*sampling_rate = type->sampling_rate;
+	*channels = 1;
+
+	if (encoding == SOURCE_WAV) {
+		size_t pos = 12;
+		int format = 0;
+
+		if (len < 12 || memcmp(data, "RIFF", 4) || memcmp(data + 8, "WAVE", 4)) {
+			return -1;
+		}
+		for (len = 0; pos + 8 <= source->len; pos += 8 + ((le32(data + pos + 4) + 1) & ~1U)) {
+			const uint32_t size = le32(data + pos + 4);
+
+			if (!memcmp(data + pos, "fmt ", 4) && 16 <= size && pos + 8 + 16 <= source->len) {
+				format = data[pos + 8] | data[pos + 9] << 8;
+				*channels = data[pos + 10] | data[pos + 11] << 8;
+				*sampling_rate = le32(data + pos + 12);
+				if (format == 1 && (data[pos + 22] | data[pos + 23] << 8) != 16) {
+					return -1; /* PCM, but not 16 bit */
+				}
+			} else if (!memcmp(data + pos, "data", 4)) {
+				data += pos + 8;
+				len = MIN(size, source->len - pos - 8);
+				break;
+			}
+		}
+		switch (format) {
+		case 1:
+			encoding = SOURCE_SLIN;
+			break;
+		case 6:
+			encoding = SOURCE_ALAW;
+			break;
+		case 7:
+			encoding = SOURCE_ULAW;
+			break;
+		default:
+			return -1;
+		}
+		if (*channels < 1 || 2 < *channels || *sampling_rate < 8000 || 96000 < *sampling_rate) {
+			return -1;
+		}
+	}
+
+	samples = encoding == SOURCE_SLIN ? len / 2 : len;
+	*pcm = malloc(MAX(samples, 1) * sizeof(**pcm));
+	if (!*pcm) {
+		return -1;
+	}
+	for (i = 0; i < samples; i++) {
+		switch (encoding) {
+		case SOURCE_SLIN:
+			(*pcm)[i] = (int16_t) (data[2 * i] | data[2 * i + 1] << 8);
+			break;
+		case SOURCE_ALAW:
+			(*pcm)[i] = alaw2lin(data[i]);
+			break;
+		default:
+			(*pcm)[i] = ulaw2lin(data[i]);
+			break;
+		}
+	}
+
+	return samples / *channels;
+}
+
+static int ogg_write(void *user_data, const unsigned char *ptr, opus_int32 len)
+{
+	return buffer_append(user_data, ptr, len);
+}
+
+static int ogg_close(void *user_data)
+{
+	return 0;
+}
+
+/*! \brief Build the index from the Ogg pages of the encoded file */
+static int index_build(const struct buffer *ogg, uint64_t source_hash, struct buffer *index)
+{
+	unsigned char header[24];
+	uint32_t packet = 0;
+	uint32_t pages = 0;
+	uint32_t pre_skip = 0;
+	size_t pos;
+
+	memcpy(header, INDEX_MAGIC, 4);
+	memset(header + 4, 0, sizeof(header) - 4);
+	if (buffer_append(index, header, sizeof(header))) {
+		return -1;
+	}
+
+	for (pos = 0; pos + 27 <= ogg->len; ) {
+		const unsigned char *page = ogg->data + pos;
+		const int segments = page[26];
+		unsigned char entry[20];
+		size_t body = 0;
+		int i;
+
+		if (memcmp(page, "OggS", 4) || ogg->len < pos + 27 + segments) {
+			return -1;
+		}
+		for (i = 0; i < segments; i++) {
+			body += page[27 + i];
+		}
+		if (pos == 0 && 27 + segments + 12 <= (int) ogg->len && !memcmp(page + 27 + segments, "OpusHead", 8)) {
+			pre_skip = page[27 + segments + 10] | page[27 + segments + 11] << 8;
+		}
+
+		for (i = 0; i < 8; i++) {
+			entry[i] = (uint64_t) pos >> (8 * i);
+			entry[8 + i] = le64(page + 6) >> (8 * i);
+		}
+		/* a packet continued from the previous page does not start here */
+		for (i = 0; i < 4; i++) {
+			entry[16 + i] = (packet + (page[5] & 0x01)) >> (8 * i);
+		}
+		if (buffer_append(index, entry, sizeof(entry))) {
+			return -1;
+		}
+		pages++;
+
+		for (i = 0; i < segments; i++) {
+			packet += page[27 + i] < 255; /* a packet ends with a lacing value below 255 */
+		}
+		pos += 27 + segments + body;
+	}
+
+	for (pos = 0; pos < 4; pos++) {
+		index->data[4 + pos] = INDEX_VERSION >> (8 * pos);
+		index->data[16 + pos] = pre_skip >> (8 * pos);
+		index->data[20 + pos] = pages >> (8 * pos);
+	}
+	for (pos = 0; pos < 8; pos++) {
+		index->data[8 + pos] = source_hash >> (8 * pos);
+	}
+
+	return 0;
+}
+
+/*! \brief Write a file at once: to a temporary file, renamed afterwards */
+static int write_file(const char *path, const struct buffer *b)
+{
+	char *tmp;
+	FILE *out;
+	int res = -1;
+
+	if (asprintf(&tmp, "%s.tmp%ld", path, (long) getpid()) < 0) {
+		return -1;
+	}
+	out = fopen(tmp, "wb");
+	if (out) {
+		res = fwrite(b->data, 1, b->len, out) == b->len ? 0 : -1;
+		res |= fclose(out);
+		if (!res) {
+			res = rename(tmp, path);
+		}
+		if (res) {
+			unlink(tmp);
+		}
+	}
+	free(tmp);
+
+	return res;
+}
+
+/*! \brief The source hash recorded in the index, 0 = none */
+static uint64_t index_hash(const char *path)
+{
+	FILE *in = fopen(path, "rb");
+	unsigned char header[16];
+	uint64_t hash = 0;
+
+	if (!in) {
+		return 0;
+	}
+	if (fread(header, 1, sizeof(header), in) == sizeof(header) && !memcmp(header, INDEX_MAGIC, 4)
+		&& le32(header + 4) == INDEX_VERSION) {
+		hash = le64(header + 8);
+	}
+	fclose(in);
+
+	return hash;
+}
+
+static char *path_with_extension(const char *source, const char *extension)
+{
+	const char *dot = strrchr(source, '.');
+	char *path;
+
+	if (asprintf(&path, "%.*s.%s", (int) (dot - source), source, extension) < 0) {
+		return NULL;
+	}
+
+	return path;
+}
+
+enum result { RESULT_CONVERTED, RESULT_SKIPPED, RESULT_FAILED };
+
+static enum result convert(const struct job *job)
+{
+	char *target = path_with_extension(job->source, "opus");
+	char *index_path = path_with_extension(job->source, "opus.idx");
+	struct buffer source = { 0 };
+	struct buffer ogg = { 0 };
+	struct buffer index = { 0 };
+	struct stat source_stat;
+	struct stat target_stat;
+	OpusEncCallbacks callbacks = { ogg_write, ogg_close };
+	OggOpusComments *comments = NULL;
+	OggOpusEnc *encoder = NULL;
+	int16_t *pcm = NULL;
+	enum result result = RESULT_FAILED;
+	uint64_t hash;
+	long samples;
+	int sampling_rate;
+	int channels;
+	int error = 0;
+
+	if (!target || !index_path || stat(job->source, &source_stat)) {
+		goto cleanup;
+	}
+	if (!force && !stat(target, &target_stat) && source_stat.st_mtime <= target_stat.st_mtime
+		&& !access(index_path, F_OK)) {
+		result = RESULT_SKIPPED;
+		goto cleanup;
+	}
+	if (dry_run) {
+		printf("%s -> %s\n", job->source, target);
+		result = RESULT_CONVERTED;
+		goto cleanup;
+	}
+
+	if (read_file(job->source, &source)) {
+		goto cleanup;
+	}
+	hash = fnv1a(source.data, source.len);
+	if (!force && !stat(target, &target_stat) && index_hash(index_path) == hash) {
+		/* touched, but the same content; mark the target as up to date */
+		utime(target, NULL);
+		result = RESULT_SKIPPED;
+		goto cleanup;
+	}
+
+	samples = source_pcm(job->type, &source, &pcm, &sampling_rate, &channels);
+	if (samples < 0) {
+		fprintf(stderr, "%s: unsupported format\n", job->source);
+		goto cleanup;
+	}
+
+	comments = ope_comments_create();
+	if (!comments) {
+		goto cleanup;
+	}
+	ope_comments_add(comments, "ENCODER", "opus_convert");
+	encoder = ope_encoder_create_callbacks(&callbacks, &ogg, comments, sampling_rate, channels, 0, &error);
+	if (!encoder) {
+		fprintf(stderr, "%s: %s\n", job->source, ope_strerror(error));
+		goto cleanup;
+	}
+	ope_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate));
+	ope_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(complexity));
+	ope_encoder_ctl(encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+	if ((error = ope_encoder_write(encoder, pcm, samples)) || (error = ope_encoder_drain(encoder))) {
+		fprintf(stderr, "%s: %s\n", job->source, ope_strerror(error));
+		goto cleanup;
+	}
+
+	if (index_build(&ogg, hash, &index)) {
+		fprintf(stderr, "%s: cannot index the encoded file\n", job->source);
+		goto cleanup;
+	}
+	/* the index last; a target without its index just gets converted again */
+	if ((unlink(index_path) && errno != ENOENT) || write_file(target, &ogg)) {
+		fprintf(stderr, "%s: %s\n", target, strerror(errno));
+		goto cleanup;
+	}
+	if (write_file(index_path, &index)) {
+		fprintf(stderr, "%s: %s\n", index_path, strerror(errno));
+		goto cleanup;
+	}
+	if (verbose) {
+		printf("%s -> %s (%ld samples at %d Hz, %zu bytes)\n", job->source, target, samples, sampling_rate, ogg.len);
+	}
+	result = RESULT_CONVERTED;
+
+cleanup:
+	if (encoder) {
+		ope_encoder_destroy(encoder);
+	}
+	if (comments) {
+		ope_comments_destroy(comments);
+	}
+	free(pcm);
+	free(source.data);
+	free(ogg.data);
+	free(index.data);
+	free(target);
+	free(index_path);
+
+	return result;
+}
+
+static void *worker(void *data)
+{
+	for (;;) {
+		struct job *job;
+		enum result result;
+
+		pthread_mutex_lock(&jobs_lock);
+		job = jobs_next < jobs_count ? &jobs[jobs_next++] : NULL;
+		pthread_mutex_unlock(&jobs_lock);
+		if (!job) {
+			return NULL;
+		}
+
+		result = convert(job);
+
+		pthread_mutex_lock(&jobs_lock);
+		switch (result) {
+		case RESULT_CONVERTED:
+			converted++;
+			break;
+		case RESULT_SKIPPED:
+			skipped++;
+			break;
+		case RESULT_FAILED:
+			failed++;
+			break;
+		}
+		pthread_mutex_unlock(&jobs_lock);
+	}
+}
+
+static const struct source_type *source_type(const char *path)
+{
+	const char *dot = strrchr(path, '.');
+	size_t i;
+
+	if (!dot || strchr(dot, '/')) {
+		return NULL;
+	}
+	for (i = 0; i < sizeof(source_types) / sizeof(source_types[0]); i++) {
+		if (!strcmp(dot + 1, source_types[i].extension)) {
+			return &source_types[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int collect(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+{
+	const struct source_type *type = source_type(path);
+
+	if (typeflag != FTW_F || !type) {
+		return 0;
+	}
+
+	if (jobs_count == jobs_size) {
+		struct job *jobs_new = realloc(jobs, (jobs_size * 2 + 256) * sizeof(*jobs));
+
+		if (!jobs_new) {
+			return -1;
+		}
+		jobs = jobs_new;
+		jobs_size = jobs_size * 2 + 256;
+	}
+	jobs[jobs_count].source = strdup(path);
+	jobs[jobs_count].type = type;
+
+	return jobs[jobs_count++].source ? 0 : -1;
+}
+
+/*! \brief By prompt, that is the path without extension, then by preference */
+static int job_cmp(const void *a, const void *b)
+{
+	const struct job *x = a;
+	const struct job *y = b;
+	const size_t x_stem = strrchr(x->source, '.') - x->source;
+	const size_t y_stem = strrchr(y->source, '.') - y->source;
+	const int res = strncmp(x->source, y->source, MIN(x_stem, y_stem));
+
+	if (res) {
+		return res;
+	} else if (x_stem != y_stem) {
+		return x_stem < y_stem ? -1 : 1;
+	}
+
+	return x->type < y->type ? -1 : x->type > y->type;
+}
+
+/*! \brief Keep the best source of each prompt, see source_types */
+static void jobs_dedup(void)
+{
+	size_t kept = 0;
+	size_t i;
+
+	qsort(jobs, jobs_count, sizeof(*jobs), job_cmp);
+	for (i = 0; i < jobs_count; i++) {
+		const size_t stem = strrchr(jobs[i].source, '.') - jobs[i].source;
+
+		if (kept && !strncmp(jobs[kept - 1].source, jobs[i].source, stem)
+			&& jobs[kept - 1].source[stem] == '.') {
+			free(jobs[i].source);
+			continue;
+		}
+		jobs[kept++] = jobs[i];
+	}
+	jobs_count = kept;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"Usage: opus_convert [options] <directory>...\n"
+		"  -j <threads>     worker threads (default: the online cores)\n"
+		"  -b <bitrate>     bit/s (default: auto)\n"
+		"  -c <complexity>  0 to 10 (default 10)\n"
+		"  -f               convert even if up to date\n"
+		"  -n               just list what would be converted\n"
+		"  -v               list each converted file\n");
+}
+
+int main(int argc, char *argv[])
+{
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_t *pool;
+	long started;
+	long i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "j:b:c:fnv")) != -1) {
+		switch (opt) {
+		case 'j':
+			threads = atol(optarg);
+			break;
+		case 'b':
+			bitrate = atoi(optarg);
+			break;
+		case 'c':
+			complexity = atoi(optarg);
+			break;
+		case 'f':
+			force = 1;
+			break;
+		case 'n':
+			dry_run = 1;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+	if (argc <= optind) {
+		usage();
+		return 1;
+	}
+
+	for (i = optind; i < argc; i++) {
+		if (nftw(argv[i], collect, 32, FTW_PHYS)) {
+			fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+			return 1;
+		}
+	}
+	jobs_dedup();
+
+	threads = MAX(MIN(threads, (long) jobs_count), 1);
+	pool = calloc(threads, sizeof(*pool));
+	if (!pool) {
+		return 1;
+	}
+	for (started = 0; started < threads; started++) {
+		if (pthread_create(&pool[started], NULL, worker, NULL)) {
+			break;
+		}
+	}
+	if (!started) {
+		worker(NULL);
+	}
+	for (i = 0; i < started; i++) {
+		pthread_join(pool[i], NULL);
+	}
+	free(pool);
+
+	printf("%u converted, %u up to date, %u failed\n", converted, skipped, failed);
+
+	for (i = 0; i < (long) jobs_count; i++) {
+		free(jobs[i].source);
+	}
+	free(jobs);
+
+	return failed ? 1 : 0;
+}
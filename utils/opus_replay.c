@@ -0,0 +1,1159 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Replay an Opus RTP stream from a capture through the decoding path
+ *
+ * Reads pcap or rtpdump, hands the packets to the playout buffer, FEC, and
+ * PLC of codec_opus_open_source.c (codecs/opus_decode.h, the same source),
+ * with the gaps in the sequence numbers as enable_native_plc.patch reports
+ * them, and writes the result as wav or raw audio. Prints the decode time
+ * of each packet and how many slots went through which case.
+ *
+ * With -E, encodes that audio again like the translators to Opus do, and
+ * writes the decode of those packets instead; the time is then per encoded
+ * frame. For regression checks, compares the output with a reference of an
+ * earlier build (-c, -q) and the time with a baseline (-B, -x), and exits
+ * with 2 when the quality or the time got worse.
+ *
+ * Build with `make utils`.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>                       /* for log10 */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <opus/opus.h>
+
+#include "asterisk/opus.h"              /* for CODEC_OPUS_DEFAULT_FEC */
+
+/* Just what opus_decode.h takes from Asterisk */
+#define ARRAY_LEN(a) (size_t) (sizeof(a) / sizeof(0[a]))
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define	AST_FRFLAG_HAS_TIMING_INFO	(1 << 0)
+#define	ast_test_flag(p, flag)	((p)->flags & (flag))
+
+#define	LOG_WARNING	"WARNING"
+#define	LOG_ERROR	"ERROR"
+#define	ast_log(level, ...)	(fprintf(stderr, "%s: ", level), fprintf(stderr, __VA_ARGS__))
+
+static int option_debug;
+#define	ast_debug(level, ...) do { \
+	if ((level) <= option_debug) { \
+		fprintf(stderr, __VA_ARGS__); \
+	} \
+} while (0)
+
+static unsigned char lin2mu(int16_t sample);
+static unsigned char lin2a(int16_t sample);
+#define	AST_LIN2MU(a)	lin2mu(a)
+#define	AST_LIN2A(a)	lin2a(a)
+
+struct ast_format;
+
+struct ast_frame {
+	struct {
+		struct ast_format *format;
+	} subclass;
+	int datalen;
+	int samples;
+	int seqno;
+	unsigned int flags;
+	union {
+		void *ptr;
+	} data;
+};
+
+struct ast_translator {
+	int buffer_samples;
+};
+
+struct ast_trans_pvt {
+	struct ast_translator *t;
+	int samples;
+	int datalen;
+	void *pvt;
+	union {
+		char *c;
+		unsigned char *uc;
+		int16_t *i16;
+	} outbuf;
+};
+
+#include "opus_decode.h"
+
+#define	RTP_SEQNO_MAX	0xffff
+#define	SNAPLEN	65536
+
+/* G.711 as in the reference implementation by Sun Microsystems */
+static int g711_segment(int value, const int *end)
+{
+	int seg;
+
+	for (seg = 0; seg < 8 && end[seg] < value; seg++) {
+	}
+
+	return seg;
+}
+
+static unsigned char lin2mu(int16_t sample)
+{
+	static const int end[8] = { 0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff, 0x1fff };
+	int value = sample >> 2;
+	int mask = 0xff;
+	int seg;
+
+	if (value < 0) {
+		value = -value;
+		mask = 0x7f;
+	}
+	value = MIN(value, 8159) + (0x84 >> 2);
+	seg = g711_segment(value, end);
+	if (8 <= seg) {
+		return 0x7f ^ mask;
+	}
+
+	return (seg << 4 | ((value >> (seg + 1)) & 0xf)) ^ mask;
+}
+
+static unsigned char lin2a(int16_t sample)
+{
+	static const int end[8] = { 0x1f, 0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff };
+	int value = sample >> 3;
+	int mask = 0xd5;
+	int seg;
+
+	if (value < 0) {
+		value = -value - 1;
+		mask = 0x55;
+	}
+	seg = g711_segment(value, end);
+	if (8 <= seg) {
+		return 0x7f ^ mask;
+	}
+
+	return (seg << 4 | ((value >> (seg < 2 ? 1 : seg)) & 0xf)) ^ mask;
+}
+
+static int16_t mu2lin(unsigned char value)
+{
+	int t;
+
+	value = ~value;
+	t = ((value & 0xf) << 3) + 0x84;
+	t <<= (value & 0x70) >> 4;
+
+	return value & 0x80 ? 0x84 - t : t - 0x84;
+}
+
+static int16_t a2lin(unsigned char value)
+{
+	int seg;
+	int t;
+
+	value ^= 0x55;
+	seg = (value & 0x70) >> 4;
+	t = (value & 0xf) << 4;
+	if (seg) {
+		t = (t + 0x108) << (seg - 1);
+	} else {
+		t += 8;
+	}
+
+	return value & 0x80 ? t : -t;
+}
+
+static int16_t g711_to_lin(enum opus_companding law, unsigned char value)
+{
+	return law == COMPANDING_ULAW ? mu2lin(value) : a2lin(value);
+}
+
+/* Options */
+static int sampling_rate = 8000;
+static enum opus_companding companding = COMPANDING_NONE;
+static int fec = CODEC_OPUS_DEFAULT_FEC;
+static int payload_type = -1;
+static long long ssrc = -1;
+static int udp_port = -1;
+static int verbose;
+static int skip_silence;
+static int encode;
+static int passes = 1;
+static const char *reference;
+static double snr_min = 40;		/* dB */
+static double baseline_us;		/* mean time per packet, or per frame with -E */
+static double baseline_percent = 10;
+
+/* Results */
+struct replay_stats {
+	unsigned int packets;
+	unsigned int missing;	/* as reported by the patch */
+	unsigned int late;	/* passed to framein only */
+	unsigned int rejected;	/* out of buffer space */
+	unsigned long long samples;
+};
+
+/* Decode time of each packet, of all passes */
+static unsigned long long *timings;
+static unsigned int timings_count;
+static unsigned int timings_size;
+
+/* With -E, like the translators from slin or G.711 to Opus */
+struct replay_encoder {
+	OpusEncoder *opus;
+	OpusDecoder *decoder;	/* of its packets, for the output */
+	struct opus_resampler *resampler;	/* from slin32 or slin44 to 48 kHz */
+	int rate;
+	int framesize;
+	int samples;	/* in buf */
+	int16_t buf[BUFFER_SAMPLES * 3];
+};
+
+struct replay {
+	struct ast_translator t;
+	struct ast_trans_pvt pvt;
+	struct opus_coder_pvt opvt;
+	unsigned char *outbuf;
+	int last_seqno;	/* of the translation path, 0x10000 = none */
+	FILE *out;
+	struct replay_encoder *encoder;
+	struct replay_stats stats;
+};
+
+/*! \brief The rate of the output, which is that of the encoder with -E */
+static int output_rate(void)
+{
+	return encode ? opus_native_rate(sampling_rate) : sampling_rate;
+}
+
+/*! \brief The encoding of the output, which is slin with -E */
+static enum opus_companding output_companding(void)
+{
+	return encode ? COMPANDING_NONE : companding;
+}
+
+/*! \brief As opus_encoder_construct() with the defaults of codec_opus.conf */
+static int replay_encoder_init(struct replay *r)
+{
+	struct replay_encoder *e = calloc(1, sizeof(*e));
+	int error = 0;
+
+	r->encoder = e;
+	if (!e) {
+		return -1;
+	}
+	e->rate = opus_native_rate(sampling_rate);
+	e->framesize = e->rate / 50;
+	if (e->rate != sampling_rate) {
+		e->resampler = calloc(1, sizeof(*e->resampler));
+		if (!e->resampler) {
+			return -1;
+		}
+		e->resampler->filter = opus_resample_filter(sampling_rate, e->rate);
+	}
+
+	e->opus = opus_encoder_create(e->rate, 1, OPUS_APPLICATION_VOIP, &error);
+	if (error != OPUS_OK) {
+		fprintf(stderr, "Error creating the Opus encoder: %s\n", opus_strerror(error));
+		return -1;
+	}
+	opus_encoder_ctl(e->opus, OPUS_SET_INBAND_FEC(fec));
+	e->decoder = opus_decoder_create(e->rate, 1, &error);
+	if (error != OPUS_OK) {
+		fprintf(stderr, "Error creating the Opus decoder: %s\n", opus_strerror(error));
+		return -1;
+	}
+
+	return 0;
+}
+
+static int replay_init(struct replay *r, FILE *out)
+{
+	const int rate = opus_native_rate(sampling_rate);
+	int error = 0;
+
+	memset(r, 0, sizeof(*r));
+	r->out = out;
+	r->last_seqno = RTP_SEQNO_MAX + 1;
+
+	/* as the translators of the module */
+	r->t.buffer_samples = (BUFFER_SAMPLES / (48000 / sampling_rate)) * 2;
+	r->outbuf = calloc(r->t.buffer_samples, sizeof(int16_t));
+	r->opvt.playout = calloc(1, sizeof(*r->opvt.playout));
+	if (!r->outbuf || !r->opvt.playout) {
+		return -1;
+	}
+	r->pvt.t = &r->t;
+	r->pvt.pvt = &r->opvt;
+	r->pvt.outbuf.uc = r->outbuf;
+
+	if (rate != sampling_rate) {
+		r->opvt.resampler = calloc(1, sizeof(*r->opvt.resampler));
+		if (!r->opvt.resampler) {
+			return -1;
+		}
+		r->opvt.resampler->filter = opus_resample_filter(rate, sampling_rate);
+	}
+
+	/* as opus_decoder_construct() */
+	r->opvt.sampling_rate = rate;
+	r->opvt.multiplier = 48000 / rate;
+	r->opvt.channels = 1;
+	r->opvt.slot_samples = rate / 50;
+	r->opvt.noise_gain = 256;
+	r->opvt.companding = companding;
+	r->opvt.decode_fec_incoming = fec;
+	r->opvt.skip_silence = skip_silence;
+	r->opvt.opus = opus_decoder_create(rate, 1, &error);
+	if (error != OPUS_OK) {
+		fprintf(stderr, "Error creating the Opus decoder: %s\n", opus_strerror(error));
+		return -1;
+	}
+	r->opvt.inited = 1;
+	opus_plc_init(&r->opvt);
+
+	if (encode) {
+		return replay_encoder_init(r);
+	}
+
+	return 0;
+}
+
+static void replay_destroy(struct replay *r)
+{
+	if (r->opvt.opus) {
+		opus_decoder_destroy(r->opvt.opus);
+	}
+	if (r->encoder) {
+		if (r->encoder->opus) {
+			opus_encoder_destroy(r->encoder->opus);
+		}
+		if (r->encoder->decoder) {
+			opus_decoder_destroy(r->encoder->decoder);
+		}
+		free(r->encoder->resampler);
+		free(r->encoder);
+	}
+	free(r->opvt.playout);
+	free(r->opvt.resampler);
+	free(r->outbuf);
+}
+
+static void replay_timing(unsigned long long ns)
+{
+	if (timings_count == timings_size) {
+		unsigned long long *timings_new = realloc(timings, (timings_size * 2 + 1024) * sizeof(*timings));
+
+		if (!timings_new) {
+			return;
+		}
+		timings = timings_new;
+		timings_size = timings_size * 2 + 1024;
+	}
+	timings[timings_count++] = ns;
+}
+
+/*!
+ * \brief Encode the output of the decoder again, frame by frame
+ *
+ * G.711 gets expanded, slin32 and slin44 resampled, as the translators
+ * to Opus do. Each frame through opus_encode() is timed; the decode of its
+ * packet goes to the file.
+ */
+static void replay_encode(struct replay *r)
+{
+	struct replay_encoder *e = r->encoder;
+	const int16_t *src = r->pvt.outbuf.i16;
+	int16_t expanded[BUFFER_SAMPLES * 2];
+	int i;
+
+	if (companding) {
+		for (i = 0; i < r->pvt.samples; i++) {
+			expanded[i] = g711_to_lin(companding, r->outbuf[i]);
+		}
+		src = expanded;
+	}
+	if (e->resampler) {
+		e->samples += opus_resample(e->resampler, e->buf + e->samples, src, r->pvt.samples, 1);
+	} else {
+		memcpy(e->buf + e->samples, src, r->pvt.samples * sizeof(*src));
+		e->samples += r->pvt.samples;
+	}
+
+	for (i = 0; i + e->framesize <= e->samples; i += e->framesize) {
+		unsigned char packet[PLAYOUT_PACKET_SIZE];
+		opus_int16 pcm[960];
+		const unsigned long long start = monotonic_ns();
+		const int len = opus_encode(e->opus, e->buf + i, e->framesize, packet, sizeof(packet));
+
+		replay_timing(monotonic_ns() - start);
+		if (len < 0) {
+			fprintf(stderr, "Error encoding the Opus frame: %s\n", opus_strerror(len));
+		}
+		if (!r->out) {
+			continue;
+		}
+		if (len < 0 || opus_decode(e->decoder, packet, len, pcm, e->framesize, 0) != e->framesize) {
+			memset(pcm, 0, sizeof(pcm));
+		}
+		fwrite(pcm, sizeof(*pcm), e->framesize, r->out);
+	}
+	e->samples -= i;
+	memmove(e->buf, e->buf + i, e->samples * sizeof(*e->buf));
+}
+
+/*! \brief What ast_trans_frameout() does, to a file */
+static int replay_frameout(struct replay *r)
+{
+	const int produced = r->pvt.samples;
+
+	if (r->encoder) {
+		replay_encode(r);
+	} else if (r->out && r->pvt.datalen) {
+		fwrite(r->outbuf, 1, r->pvt.datalen, r->out);
+	}
+	r->stats.samples += r->pvt.samples;
+	r->pvt.samples = 0;
+	r->pvt.datalen = 0;
+
+	return produced;
+}
+
+/*! \brief What framein() does, which checks the samples against the buffer as is */
+static int replay_framein(struct replay *r, struct ast_frame *f)
+{
+	if (r->pvt.samples + f->samples > r->t.buffer_samples) {
+		r->stats.rejected++;
+		return -1;
+	}
+
+	return opus_decode_frame(&r->pvt, f);
+}
+
+/*!
+ * \brief Pass one RTP payload like ast_translate() with the native-PLC patch
+ *
+ * The gap to the sequence number of the translation path is computed the
+ * same way, including the off-by-one on wrap, and lost frames go in the
+ * same batches, each with the sequence number of its last frame.
+ */
+static void replay_packet(struct replay *r, int seqno, unsigned int timestamp, unsigned char *payload, int len)
+{
+	struct opus_decode_stats before = r->opvt.stats;
+	struct ast_frame f = {
+		.datalen = len,
+		.seqno = seqno,
+		.flags = AST_FRFLAG_HAS_TIMING_INFO,
+		.data.ptr = payload,
+	};
+	unsigned long long start;
+	unsigned long long elapsed;
+	int frames_missing = 0;
+	int frames_batch_max;
+	int frames_batch;
+	int produced = 0;
+
+	f.samples = opus_packet_get_nb_samples(payload, len, 48000);
+	if (f.samples <= 0) {
+		f.samples = 960;
+	}
+
+	if (r->last_seqno <= RTP_SEQNO_MAX && r->last_seqno != seqno) {
+		if (seqno < r->last_seqno) {
+			frames_missing = RTP_SEQNO_MAX + seqno - r->last_seqno - 1;
+		} else {
+			frames_missing = seqno - r->last_seqno - 1;
+		}
+		if ((RTP_SEQNO_MAX + 1) / 2 < frames_missing) {
+			start = monotonic_ns();
+			replay_framein(r, &f);
+			elapsed = monotonic_ns() - start;
+			if (!encode) {
+				replay_timing(elapsed);
+			}
+			r->stats.late++;
+			if (verbose) {
+				printf("%5d %10u %4d late %8.1f us\n", seqno, timestamp, len, elapsed / 1000.0);
+			}
+			return;
+		}
+	}
+
+	frames_batch_max = MAX((r->t.buffer_samples - r->pvt.samples) / f.samples, 1);
+	r->stats.missing += frames_missing;
+
+	start = monotonic_ns();
+	for (; frames_missing + 1; frames_missing -= frames_batch) {
+		struct ast_frame missed = {
+			.datalen = 0,
+			.flags = AST_FRFLAG_HAS_TIMING_INFO,
+		};
+
+		frames_batch = frames_missing ? MIN(frames_missing, frames_batch_max) : 1;
+		missed.samples = f.samples * frames_batch;
+		missed.seqno = (RTP_SEQNO_MAX + seqno - frames_missing + frames_batch) & RTP_SEQNO_MAX;
+
+		replay_framein(r, frames_missing ? &missed : &f);
+		produced += replay_frameout(r);
+	}
+	elapsed = monotonic_ns() - start;
+	if (!encode) {
+		replay_timing(elapsed);
+	}
+
+	/* The path keeps the sequence number of the last frame with output */
+	if (produced) {
+		r->last_seqno = seqno;
+	}
+
+	if (verbose) {
+		printf("%5d %10u %4d %s decoded %u fec %u plc %u noise %u skipped %u, %5d samples %8.1f us\n",
+			seqno, timestamp, len, opus_packet_activity(payload, len) ? "active" : "silent",
+			r->opvt.stats.decoded - before.decoded,
+			r->opvt.stats.recovered - before.recovered,
+			r->opvt.stats.concealed - before.concealed,
+			r->opvt.stats.noise - before.noise,
+			r->opvt.stats.skipped - before.skipped,
+			produced, elapsed / 1000.0);
+	}
+}
+
+/*! \brief Filter RTP, select the stream, and strip the header */
+static void rtp_packet(struct replay *r, unsigned char *rtp, int len)
+{
+	int header = 12;
+	int pt;
+	unsigned int packet_ssrc;
+
+	if (len < header || (rtp[0] >> 6) != 2) {
+		return;
+	}
+	pt = rtp[1] & 0x7f;
+	if (72 <= pt && pt <= 76) {
+		return; /* RTCP */
+	}
+	packet_ssrc = (unsigned int) rtp[8] << 24 | rtp[9] << 16 | rtp[10] << 8 | rtp[11];
+	if (payload_type < 0) {
+		payload_type = pt;
+	}
+	if (ssrc < 0 && pt == payload_type) {
+		ssrc = packet_ssrc;
+		fprintf(stderr, "Replaying payload type %d, SSRC 0x%08x\n", pt, packet_ssrc);
+	}
+	if (pt != payload_type || packet_ssrc != ssrc) {
+		return;
+	}
+
+	header += (rtp[0] & 0x0f) * 4;
+	if ((rtp[0] & 0x10) && header + 4 <= len) {
+		header += 4 + (rtp[header + 2] << 8 | rtp[header + 3]) * 4;
+	}
+	if ((rtp[0] & 0x20) && header < len) {
+		len -= rtp[len - 1];
+	}
+	if (len <= header) {
+		return;
+	}
+
+	r->stats.packets++;
+	replay_packet(r, rtp[2] << 8 | rtp[3],
+		(unsigned int) rtp[4] << 24 | rtp[5] << 16 | rtp[6] << 8 | rtp[7],
+		rtp + header, len - header);
+}
+
+/*! \brief Find the UDP payload in a captured frame of a link type */
+static void pcap_frame(struct replay *r, int linktype, unsigned char *data, int len)
+{
+	int ethertype;
+	int offset;
+	int protocol;
+
+	switch (linktype) {
+	case 0: /* BSD loopback */
+		offset = 4;
+		ethertype = 0;
+		break;
+	case 1: /* Ethernet */
+		offset = 14;
+		if (len < offset) {
+			return;
+		}
+		ethertype = data[12] << 8 | data[13];
+		while (ethertype == 0x8100 && offset + 4 <= len) { /* VLAN */
+			ethertype = data[offset + 2] << 8 | data[offset + 3];
+			offset += 4;
+		}
+		break;
+	case 101: /* raw IP */
+		offset = 0;
+		ethertype = 0;
+		break;
+	case 113: /* Linux cooked */
+		offset = 16;
+		if (len < offset) {
+			return;
+		}
+		ethertype = data[14] << 8 | data[15];
+		break;
+	case 276: /* Linux cooked v2 */
+		offset = 20;
+		if (len < offset) {
+			return;
+		}
+		ethertype = data[0] << 8 | data[1];
+		break;
+	default:
+		return;
+	}
+	if (len <= offset) {
+		return;
+	}
+	if (!ethertype) {
+		ethertype = (data[offset] >> 4) == 6 ? 0x86dd : 0x0800;
+	}
+
+	if (ethertype == 0x0800 && offset + 20 <= len && (data[offset] >> 4) == 4) {
+		if ((data[offset + 6] & 0x3f) || data[offset + 7]) {
+			return; /* fragment */
+		}
+		protocol = data[offset + 9];
+		offset += (data[offset] & 0x0f) * 4;
+	} else if (ethertype == 0x86dd && offset + 40 <= len) {
+		protocol = data[offset + 6]; /* no extension headers */
+		offset += 40;
+	} else {
+		return;
+	}
+	if (protocol != 17 || len < offset + 8) {
+		return;
+	}
+	if (0 <= udp_port
+		&& (data[offset] << 8 | data[offset + 1]) != udp_port
+		&& (data[offset + 2] << 8 | data[offset + 3]) != udp_port) {
+		return;
+	}
+
+	rtp_packet(r, data + offset + 8, len - offset - 8);
+}
+
+static uint32_t read32(const unsigned char *p, int swap)
+{
+	return swap
+		? (uint32_t) p[3] << 24 | p[2] << 16 | p[1] << 8 | p[0]
+		: (uint32_t) p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static int read_pcap(struct replay *r, FILE *in, const unsigned char *magic)
+{
+	unsigned char header[24];
+	unsigned char record[16];
+	unsigned char *data = malloc(SNAPLEN);
+	int swap;
+	int linktype;
+
+	if (!data) {
+		return -1;
+	}
+	memcpy(header, magic, 4);
+	if (fread(header + 4, 1, sizeof(header) - 4, in) != sizeof(header) - 4) {
+		free(data);
+		return -1;
+	}
+	swap = header[0] == 0xd4 || header[0] == 0x4d;
+	linktype = read32(header + 20, swap) & 0xffff;
+
+	while (fread(record, 1, sizeof(record), in) == sizeof(record)) {
+		const uint32_t caplen = read32(record + 8, swap);
+
+		if (SNAPLEN < caplen) {
+			fprintf(stderr, "Corrupt capture: record of %u bytes\n", caplen);
+			break;
+		}
+		if (fread(data, 1, caplen, in) != caplen) {
+			break;
+		}
+		pcap_frame(r, linktype, data, caplen);
+	}
+
+	free(data);
+
+	return 0;
+}
+
+static int read_rtpdump(struct replay *r, FILE *in)
+{
+	char line[256];
+	unsigned char header[16];
+	unsigned char record[8];
+	unsigned char *data = malloc(SNAPLEN);
+
+	if (!data) {
+		return -1;
+	}
+	/* "#!rtpplay1.0 address/port\n", then the binary file header */
+	if (!fgets(line, sizeof(line), in) || fread(header, 1, sizeof(header), in) != sizeof(header)) {
+		free(data);
+		return -1;
+	}
+
+	while (fread(record, 1, sizeof(record), in) == sizeof(record)) {
+		const int length = record[0] << 8 | record[1];
+		const int plen = record[2] << 8 | record[3];
+
+		if (length < (int) sizeof(record) || fread(data, 1, length - sizeof(record), in) != length - sizeof(record)) {
+			break;
+		}
+		if (plen) { /* 0 = RTCP */
+			rtp_packet(r, data, MIN(plen, length - (int) sizeof(record)));
+		}
+	}
+
+	free(data);
+
+	return 0;
+}
+
+static int read_capture(struct replay *r, const char *filename)
+{
+	FILE *in = fopen(filename, "rb");
+	unsigned char magic[4];
+	int res = -1;
+
+	if (!in) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	if (fread(magic, 1, sizeof(magic), in) == sizeof(magic)) {
+		if (!memcmp(magic, "\xa1\xb2\xc3\xd4", 4) || !memcmp(magic, "\xd4\xc3\xb2\xa1", 4)
+			|| !memcmp(magic, "\xa1\xb2\x3c\x4d", 4) || !memcmp(magic, "\x4d\x3c\xb2\xa1", 4)) {
+			res = read_pcap(r, in, magic);
+		} else if (!memcmp(magic, "#!rt", 4)) {
+			rewind(in);
+			res = read_rtpdump(r, in);
+		} else if (!memcmp(magic, "\x0a\x0d\x0d\x0a", 4)) {
+			fprintf(stderr, "%s: pcapng is not supported; convert it with 'editcap -F pcap'\n", filename);
+		} else {
+			fprintf(stderr, "%s: neither pcap nor rtpdump\n", filename);
+		}
+	}
+
+	fclose(in);
+
+	return res;
+}
+
+static void write_le(FILE *out, uint32_t value, int bytes)
+{
+	while (bytes--) {
+		fputc(value & 0xff, out);
+		value >>= 8;
+	}
+}
+
+/*! \brief RIFF header; call again at the end for the final sizes */
+static void write_wav_header(FILE *out, uint32_t datalen)
+{
+	const enum opus_companding law = output_companding();
+	const int bytes = law ? 1 : 2;
+	const int format = law == COMPANDING_ULAW ? 7 : law == COMPANDING_ALAW ? 6 : 1;
+
+	fseek(out, 0, SEEK_SET);
+	fwrite("RIFF", 1, 4, out);
+	write_le(out, 36 + datalen, 4);
+	fwrite("WAVEfmt ", 1, 8, out);
+	write_le(out, 16, 4);
+	write_le(out, format, 2);
+	write_le(out, 1, 2);
+	write_le(out, output_rate(), 4);
+	write_le(out, output_rate() * bytes, 4);
+	write_le(out, bytes, 2);
+	write_le(out, bytes * 8, 2);
+	fwrite("data", 1, 4, out);
+	write_le(out, datalen, 4);
+}
+
+static int compare_ns(const void *a, const void *b)
+{
+	const unsigned long long x = *(const unsigned long long *) a;
+	const unsigned long long y = *(const unsigned long long *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*!
+ * \brief Read a wav or raw file as written by this tool, without header
+ *
+ * \return Amount of bytes in *data, -1 on error
+ */
+static long read_audio(FILE *in, const char *name, unsigned char **data)
+{
+	unsigned char header[44];
+	long len;
+
+	*data = NULL;
+	if (fseek(in, 0, SEEK_END) || (len = ftell(in)) < 0 || fseek(in, 0, SEEK_SET)) {
+		fprintf(stderr, "%s: %s\n", name, strerror(errno));
+		return -1;
+	}
+	if (sizeof(header) <= len && fread(header, 1, sizeof(header), in) == sizeof(header)
+		&& !memcmp(header, "RIFF", 4)) {
+		len -= sizeof(header);
+	} else if (fseek(in, 0, SEEK_SET)) {
+		fprintf(stderr, "%s: %s\n", name, strerror(errno));
+		return -1;
+	}
+
+	*data = malloc(len + 1);
+	if (!*data) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+	if (fread(*data, 1, len, in) != len) {
+		fprintf(stderr, "%s: short read\n", name);
+		free(*data);
+		*data = NULL;
+		return -1;
+	}
+
+	return len;
+}
+
+/*!
+ * \brief Compare the output with the reference, as signal-to-noise ratio
+ *
+ * Both in slin, or both in the same G.711, of the same rate. A difference in
+ * length counts as failure, because then the playout or the concealment
+ * took another decision.
+ *
+ * \retval 0 within -q
+ * \retval 1 error
+ * \retval 2 regression
+ */
+static int compare_reference(FILE *out)
+{
+	FILE *in = fopen(reference, "rb");
+	const enum opus_companding law = output_companding();
+	const int bytes = law ? 1 : 2;
+	unsigned char *expected = NULL;
+	unsigned char *actual = NULL;
+	long expected_len;
+	long actual_len;
+	double signal = 0;
+	double noise = 0;
+	double snr;
+	int diff_max = 0;
+	long i;
+	int res = 2;
+
+	if (!in) {
+		fprintf(stderr, "%s: %s\n", reference, strerror(errno));
+		return 1;
+	}
+	fflush(out);
+	expected_len = read_audio(in, reference, &expected);
+	actual_len = read_audio(out, "output", &actual);
+	fclose(in);
+	if (expected_len < 0 || actual_len < 0) {
+		free(expected);
+		free(actual);
+		return 1;
+	}
+
+	for (i = 0; i + bytes <= MIN(expected_len, actual_len); i += bytes) {
+		const int x = law ? g711_to_lin(law, expected[i]) : (int16_t) (expected[i] | expected[i + 1] << 8);
+		const int y = law ? g711_to_lin(law, actual[i]) : (int16_t) (actual[i] | actual[i + 1] << 8);
+
+		signal += (double) x * x;
+		noise += (double) (x - y) * (x - y);
+		diff_max = MAX(diff_max, abs(x - y));
+	}
+	snr = noise ? 10 * log10(signal / noise) : INFINITY;
+
+	if (expected_len != actual_len) {
+		printf("reference:   FAIL, %.2f s instead of %.2f s\n",
+			(double) actual_len / bytes / output_rate(), (double) expected_len / bytes / output_rate());
+	} else if (snr < snr_min) {
+		printf("reference:   FAIL, SNR %.1f dB below %.1f dB, max difference %d\n", snr, snr_min, diff_max);
+	} else {
+		printf("reference:   ok, SNR %.1f dB, max difference %d\n", snr, diff_max);
+		res = 0;
+	}
+	free(expected);
+	free(actual);
+
+	return res;
+}
+
+/*!
+ * \brief Compare the mean decode or encode time with the baseline
+ *
+ * \retval 0 within -x
+ * \retval 2 regression
+ */
+static int compare_baseline(void)
+{
+	unsigned long long total = 0;
+	double mean;
+	unsigned int i;
+
+	if (!timings_count) {
+		return 0;
+	}
+	for (i = 0; i < timings_count; i++) {
+		total += timings[i];
+	}
+	mean = total / 1000.0 / timings_count;
+
+	if (baseline_us * (1 + baseline_percent / 100) < mean) {
+		printf("baseline:    FAIL, %.1f us instead of %.1f us, %+.0f%% over %.0f%%\n",
+			mean, baseline_us, (mean / baseline_us - 1) * 100, baseline_percent);
+		return 2;
+	}
+	printf("baseline:    ok, %.1f us, %+.0f%% to %.1f us\n", mean, (mean / baseline_us - 1) * 100, baseline_us);
+
+	return 0;
+}
+
+static void print_stats(struct replay *r)
+{
+	struct replay_stats *s = &r->stats;
+	struct opus_decode_stats *d = &r->opvt.stats;
+	unsigned long long total = 0;
+	unsigned int i;
+
+	printf("packets:     %u, %u missing, %u late, %u reordered but in time\n",
+		s->packets, s->missing, s->late, r->opvt.playout->reordered);
+	if (s->rejected) {
+		printf("framein:     %u frames out of buffer space\n", s->rejected);
+	}
+	printf("slots:       %u decoded, %u via FEC, %u via PLC, %u comfort noise, %u skipped\n",
+		d->decoded, d->recovered, d->concealed, d->noise, d->skipped);
+	printf("playout:     depth %d at the end\n", r->opvt.playout->depth);
+	printf("output:      %.2f s\n", (double) s->samples / sampling_rate);
+
+	if (!timings_count) {
+		return;
+	}
+	qsort(timings, timings_count, sizeof(*timings), compare_ns);
+	for (i = 0; i < timings_count; i++) {
+		total += timings[i];
+	}
+	printf("%s time: mean %.1f us, median %.1f us, 99%% %.1f us, max %.1f us per %s\n",
+		encode ? "encode" : "decode",
+		total / 1000.0 / timings_count,
+		timings[timings_count / 2] / 1000.0,
+		timings[(unsigned int) (timings_count * 0.99)] / 1000.0,
+		timings[timings_count - 1] / 1000.0,
+		encode ? "frame" : "packet");
+	if (s->samples) {
+		printf("real time:   %.0fx\n", (double) s->samples * passes / sampling_rate * 1e9 / total);
+	}
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"Usage: opus_replay [options] <capture.pcap|capture.rtpdump> [<output.wav|output.raw>]\n"
+		"  -r <rate>      output sampling rate: 8000 (default), 12000, 16000, 24000, 32000,\n"
+		"                 44100, 48000\n"
+		"  -e <encoding>  output encoding: slin (default), ulaw, alaw; G.711 is 8000 only\n"
+		"  -E             encode the output again, like the translators from that rate and\n"
+		"                 encoding to Opus; writes the decode of those packets, in slin\n"
+		"  -f <0|1>       FEC negotiated (default %d)\n"
+		"  -t <pt>        RTP payload type (default: of the first RTP packet)\n"
+		"  -s <ssrc>      RTP SSRC, in hex (default: of the first packet of that type)\n"
+		"  -u <port>      UDP port, source or destination (pcap only)\n"
+		"  -k             skip decoding while the sender is silent, like skip_silence\n"
+		"  -p <tier>      concealment: strong, classic (default), noise, like plc\n"
+		"  -b <percent>   CPU budget of the concealment, like plc_budget\n"
+		"  -n <passes>    replay that often, for timing; the output is from the first\n"
+		"  -v             print each packet: cases, samples, and decode time\n"
+		"  -d <level>     print the debug messages of the decoder up to level\n"
+		"  -c <file>      compare the output (slin) with that of an earlier build\n"
+		"  -q <dB>        minimal signal-to-noise ratio to the reference (default 40)\n"
+		"  -B <us>        baseline of the mean decode time per packet, encode time per frame\n"
+		"  -x <percent>   allowed increase over the baseline (default 10)\n"
+		"Exits with 2 when the output or the time fails -c or -B.\n",
+		CODEC_OPUS_DEFAULT_FEC);
+}
+
+int main(int argc, char *argv[])
+{
+	struct replay r;
+	FILE *out = NULL;
+	int wav = 0;
+	int res = 0;
+	int pass;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:e:Ef:t:s:u:kp:b:n:vd:c:q:B:x:")) != -1) {
+		switch (opt) {
+		case 'r':
+			sampling_rate = atoi(optarg);
+			break;
+		case 'e':
+			if (!strcmp(optarg, "ulaw")) {
+				companding = COMPANDING_ULAW;
+			} else if (!strcmp(optarg, "alaw")) {
+				companding = COMPANDING_ALAW;
+			} else if (strcmp(optarg, "slin")) {
+				usage();
+				return 1;
+			}
+			break;
+		case 'E':
+			encode = 1;
+			break;
+		case 'f':
+			fec = atoi(optarg);
+			break;
+		case 't':
+			payload_type = atoi(optarg);
+			break;
+		case 's':
+			ssrc = strtoll(optarg, NULL, 16);
+			break;
+		case 'u':
+			udp_port = atoi(optarg);
+			break;
+		case 'k':
+			skip_silence = 1;
+			break;
+		case 'p':
+			if (!strcmp(optarg, "strong")) {
+				plc_budget.tier = PLC_TIER_STRONG;
+			} else if (!strcmp(optarg, "noise")) {
+				plc_budget.tier = PLC_TIER_NOISE;
+			} else if (strcmp(optarg, "classic")) {
+				usage();
+				return 1;
+			}
+			break;
+		case 'b':
+			plc_budget.cpu_percent = MAX(atoi(optarg), 0);
+			break;
+		case 'n':
+			passes = MAX(atoi(optarg), 1);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		case 'd':
+			option_debug = atoi(optarg);
+			break;
+		case 'c':
+			reference = optarg;
+			break;
+		case 'q':
+			snr_min = atof(optarg);
+			break;
+		case 'B':
+			baseline_us = atof(optarg);
+			break;
+		case 'x':
+			baseline_percent = MAX(atof(optarg), 0);
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+	if (optind + 1 != argc && optind + 2 != argc) {
+		usage();
+		return 1;
+	}
+	if (sampling_rate != 8000 && sampling_rate != 12000 && sampling_rate != 16000
+		&& sampling_rate != 24000 && sampling_rate != 32000 && sampling_rate != 44100
+		&& sampling_rate != 48000) {
+		fprintf(stderr, "Invalid sampling rate %d\n", sampling_rate);
+		return 1;
+	}
+	if (companding && sampling_rate != 8000) {
+		fprintf(stderr, "G.711 requires a sampling rate of 8000\n");
+		return 1;
+	}
+
+	if (optind + 2 == argc) {
+		const char *name = argv[optind + 1];
+		const size_t len = strlen(name);
+
+		out = fopen(name, reference ? "w+b" : "wb");
+		if (!out) {
+			fprintf(stderr, "%s: %s\n", name, strerror(errno));
+			return 1;
+		}
+		wav = 4 < len && !strcasecmp(name + len - 4, ".wav");
+		if (wav) {
+			write_wav_header(out, 0);
+		}
+	} else if (reference) {
+		out = tmpfile();
+		if (!out) {
+			fprintf(stderr, "tmpfile: %s\n", strerror(errno));
+			return 1;
+		}
+	}
+
+	comfort_noise_init();
+	if (opus_resample_init()) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for (pass = 0; pass < passes; pass++) {
+		if (replay_init(&r, pass ? NULL : out) || read_capture(&r, argv[optind])) {
+			replay_destroy(&r);
+			return 1;
+		}
+		if (pass + 1 < passes) {
+			replay_destroy(&r);
+		}
+		verbose = 0;
+	}
+
+	if (out) {
+		if (wav) {
+			write_wav_header(out, ftell(out) - 44);
+		}
+	}
+
+	print_stats(&r);
+	if (reference) {
+		res = compare_reference(out);
+	}
+	if (baseline_us && res != 1 && compare_baseline()) {
+		res = 2;
+	}
+	if (out) {
+		fclose(out);
+	}
+	replay_destroy(&r);
+	free(timings);
+
+	return res;
+}